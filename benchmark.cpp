@@ -0,0 +1,377 @@
+#include "benchmark.h"
+#include "hitbox.h"
+#include "shot.h"
+
+#include "core/hashfuncs.h"
+#include "core/image.h"
+#include "core/io/config_file.h"
+#include "core/os/os.h"
+
+static const char* scenario_names[DanmakuBenchmark::SCENARIO_MAX] = {
+    "circle_spam",
+    "curving",
+    "bomb",
+    "sprites",
+    "effects",
+    "effects_interpreted"
+};
+
+Dictionary DanmakuBenchmark::run(const String& p_scenario) {
+    ERR_FAIL_COND_V_MSG(!is_inside_tree(), Dictionary(), "DanmakuBenchmark must be inside the scene tree.");
+
+    int scenario = -1;
+    for (int i = 0; i != SCENARIO_MAX; ++i) {
+        if (p_scenario == scenario_names[i]) {
+            scenario = i;
+        }
+    }
+    ERR_FAIL_COND_V_MSG(scenario == -1, Dictionary(), "Unknown benchmark scenario: " + p_scenario);
+
+    // Only the interpreted scenario turns native programs off, everything else runs the way the caller set it
+    bool interpreted = scenario == SCENARIO_EFFECTS_INTERPRETED;
+    bool native_enabled = ShotEffect::is_native_enabled();
+    if (interpreted) {
+        ShotEffect::set_native_enabled(false);
+    }
+    _setup((Scenario)scenario);
+
+    Vector<uint64_t> times;
+    times.resize(ticks);
+    uint64_t total = 0;
+
+    for (int i = 0; i != ticks; ++i) {
+        _step((Scenario)scenario, i);
+
+        uint64_t begin = OS::get_singleton()->get_ticks_usec();
+        danmaku->tick();
+        danmaku->_update_buffer();
+        uint64_t elapsed = OS::get_singleton()->get_ticks_usec() - begin;
+
+        times.write[i] = elapsed;
+        total += elapsed;
+    }
+
+    uint32_t checksum = _checksum();
+    int active = danmaku->get_active_shot_count();
+    _teardown();
+    ShotEffect::set_native_enabled(native_enabled);
+
+    times.sort();
+    int64_t p50 = ticks ? times[(ticks - 1) * 50 / 100] : 0;
+    int64_t p99 = ticks ? times[(ticks - 1) * 99 / 100] : 0;
+    int64_t peak = ticks ? times[ticks - 1] : 0;
+
+    // Checksums are keyed by tick count too, since a shorter run naturally ends in a different state
+    String key = p_scenario + "_" + itos(ticks);
+    String status = "missing";
+    Ref<ConfigFile> golden;
+    golden.instance();
+    golden->load(golden_path);
+
+    if (update_golden) {
+        golden->set_value("checksums", key, (int64_t)checksum);
+        golden->save(golden_path);
+        status = "recorded";
+    } else if (golden->has_section_key("checksums", key)) {
+        status = (int64_t)golden->get_value("checksums", key) == (int64_t)checksum ? "match" : "mismatch";
+        if (status == "mismatch") {
+            WARN_PRINT("Benchmark scenario " + p_scenario + " does not match its golden checksum!");
+        }
+    } else {
+        WARN_PRINT("Benchmark scenario " + p_scenario + " has no golden checksum in " + golden_path + ".");
+    }
+
+    Dictionary result;
+    result["scenario"] = p_scenario;
+    result["ticks"] = ticks;
+    result["active_shots"] = active;
+    result["mean_usec"] = ticks ? (int64_t)(total / ticks) : 0;
+    result["p50_usec"] = p50;
+    result["p99_usec"] = p99;
+    result["max_usec"] = peak;
+    result["checksum"] = (int64_t)checksum;
+    result["golden"] = status;
+    result["interpreted"] = interpreted;
+
+    print_line(p_scenario + ": p50 " + itos(p50) + "us, p99 " + itos(p99) + "us, max " + itos(peak) + "us, checksum " + String::num_int64(checksum, 16) + " (" + status + ")");
+    return result;
+}
+
+Dictionary DanmakuBenchmark::run_all() {
+    Dictionary results;
+    for (int i = 0; i != SCENARIO_MAX; ++i) {
+        results[scenario_names[i]] = run(scenario_names[i]);
+    }
+    return results;
+}
+
+PoolStringArray DanmakuBenchmark::get_scenarios() const {
+    PoolStringArray names;
+    for (int i = 0; i != SCENARIO_MAX; ++i) {
+        names.push_back(scenario_names[i]);
+    }
+    return names;
+}
+
+void DanmakuBenchmark::_setup(Scenario p_scenario) {
+    danmaku = memnew(Danmaku);
+    danmaku->set_max_shots(4096);
+
+    Ref<Image> image;
+    image.instance();
+    image->create(64, 64, false, Image::FORMAT_RGBA8);
+    Ref<ImageTexture> atlas;
+    atlas.instance();
+    atlas->create_from_image(image);
+    danmaku->set_atlas(atlas);
+
+    bool animated = p_scenario == SCENARIO_SPRITES || p_scenario == SCENARIO_BOMB;
+    danmaku->set_shot_sprite(0, _make_sprite("ball", animated ? 4 : 1, animated));
+    add_child(danmaku);
+
+    Hitbox* hitbox = memnew(Hitbox);
+    hitbox->set_position(Vector2(192, 400));
+    danmaku->add_child(hitbox);
+
+    switch (p_scenario) {
+        case SCENARIO_CIRCLE_SPAM: {
+            _add_pattern(Vector2(192, 128));
+        } break;
+
+        case SCENARIO_CURVING: {
+            // Curve every five ticks with a timer loop, and drift back every tick on a yield loop
+            effect.instance();
+            Register timer = effect->state(0);
+            effect->timer(timer);
+            effect->add(Shot::ROTATION, effect->val(0.05), Shot::ROTATION);
+            effect->add(Shot::SPEED, effect->val(0.02), Shot::SPEED);
+            effect->vmove(4, timer);
+
+            Ref<ShotEffect> drift;
+            drift.instance();
+            drift->add(Shot::ROTATION, drift->val(-0.004), Shot::ROTATION);
+            drift->yield();
+            effect->set_next_pass(drift);
+
+            _add_pattern(Vector2(96, 96));
+            _add_pattern(Vector2(288, 96));
+        } break;
+
+        case SCENARIO_BOMB: {
+            _add_pattern(Vector2(64, 160));
+            _add_pattern(Vector2(320, 160));
+        } break;
+
+        case SCENARIO_SPRITES: {
+            _add_pattern(Vector2(192, 64));
+        } break;
+
+        case SCENARIO_EFFECTS:
+        case SCENARIO_EFFECTS_INTERPRETED: {
+            // Wobble every tick, mixing state, REG0-7 and motion registers with one interpreted sin
+            effect.instance();
+            Register phase = effect->state(0.0);
+            effect->add(phase, effect->val(0.1), phase);
+            effect->sin(phase, Shot::REG0);
+            effect->mul(Shot::REG0, effect->val(0.03), Shot::REG1);
+            effect->add(Shot::ROTATION, Shot::REG1, Shot::ROTATION);
+            effect->mul(Shot::SPEED, effect->val(1.001), Shot::SPEED);
+            effect->yield();
+
+            _add_pattern(Vector2(96, 128));
+            _add_pattern(Vector2(288, 128));
+        } break;
+
+        default: break;
+    }
+}
+
+void DanmakuBenchmark::_step(Scenario p_scenario, int p_tick) {
+    switch (p_scenario) {
+        case SCENARIO_CIRCLE_SPAM: {
+            if (danmaku->get_free_shot_count() >= 64) {
+                patterns[0]->set_fire_count(64);
+                patterns[0]->set_fire_speed(1.5);
+                patterns[0]->set_fire_rotation(p_tick * 0.1);
+                patterns[0]->fire_circle();
+            }
+        } break;
+
+        case SCENARIO_CURVING: {
+            if (p_tick % 4 == 0) {
+                for (int i = 0; i != patterns.size(); ++i) {
+                    if (danmaku->get_free_shot_count() >= 16) {
+                        patterns[i]->set_fire_count(16);
+                        patterns[i]->set_fire_speed(1);
+                        patterns[i]->set_fire_rotation(p_tick * 0.05 * (i ? -1 : 1));
+                        patterns[i]->set_fire_effect(effect);
+                        patterns[i]->fire_circle();
+                    }
+                }
+            }
+        } break;
+
+        case SCENARIO_BOMB: {
+            for (int i = 0; i != patterns.size(); ++i) {
+                if (danmaku->get_free_shot_count() >= 32) {
+                    patterns[i]->set_fire_count(32);
+                    patterns[i]->set_fire_speed(2);
+                    patterns[i]->set_fire_rotation(p_tick * 0.13);
+                    patterns[i]->fire_circle();
+                }
+            }
+            if (p_tick % 30 == 29) {
+                danmaku->clear_circle(Vector2(192, 224), 160);
+            }
+        } break;
+
+        case SCENARIO_SPRITES: {
+            if (p_tick % 2 == 0 && danmaku->get_free_shot_count() >= 24) {
+                patterns[0]->set_fire_count(24);
+                patterns[0]->set_fire_speed(1.25);
+                patterns[0]->set_fire_rotation(Math_PI / 2);
+                patterns[0]->set_fire_aim(true);
+                patterns[0]->fire_fan(Math_PI);
+            }
+            if (p_tick % 60 == 59) {
+                danmaku->clear_all();
+            }
+        } break;
+
+        case SCENARIO_EFFECTS:
+        case SCENARIO_EFFECTS_INTERPRETED: {
+            if (p_tick % 4 == 0) {
+                for (int i = 0; i != patterns.size(); ++i) {
+                    if (danmaku->get_free_shot_count() >= 32) {
+                        patterns[i]->set_fire_count(32);
+                        patterns[i]->set_fire_speed(1);
+                        patterns[i]->set_fire_rotation(p_tick * 0.07 * (i ? -1 : 1));
+                        patterns[i]->set_fire_effect(effect);
+                        patterns[i]->fire_circle();
+                    }
+                }
+            }
+        } break;
+
+        default: break;
+    }
+}
+
+void DanmakuBenchmark::_teardown() {
+    remove_child(danmaku);
+    memdelete(danmaku);
+    danmaku = NULL;
+    patterns.clear();
+    effect = Ref<ShotEffect>();
+}
+
+Pattern* DanmakuBenchmark::_add_pattern(const Vector2& p_position) {
+    Pattern* pattern = memnew(Pattern);
+    pattern->set_position(p_position);
+    danmaku->add_child(pattern);
+    patterns.push_back(pattern);
+    return pattern;
+}
+
+Ref<ShotSprite> DanmakuBenchmark::_make_sprite(const String& p_key, int p_frames, bool p_clear) {
+    Ref<ShotSprite> sprite;
+    sprite.instance();
+    sprite->set_key(p_key);
+    sprite->set_region(Rect2(0, 0, 16 * p_frames, 16));
+    sprite->set_x_frames(p_frames);
+    sprite->set_frame_delay(3);
+    sprite->set_collider_radius(4);
+    sprite->set_face_motion(p_frames > 1);
+
+    if (p_clear) {
+        Ref<ShotSprite> clear;
+        clear.instance();
+        clear->set_region(Rect2(0, 16, 64, 16));
+        clear->set_x_frames(4);
+        clear->set_frame_delay(2);
+        sprite->set_clear_sprite(clear);
+
+        Ref<ShotSprite> spawn;
+        spawn.instance();
+        spawn->set_region(Rect2(0, 32, 32, 16));
+        spawn->set_x_frames(2);
+        spawn->set_frame_delay(4);
+        sprite->set_spawn_sprite(spawn);
+    }
+    return sprite;
+}
+
+uint32_t DanmakuBenchmark::_checksum() const {
+    uint32_t hash = hash_djb2_one_32(danmaku->get_active_shot_count());
+
+    for (int i = 0; i != patterns.size(); ++i) {
+        Pattern* pattern = patterns[i];
+        hash = hash_djb2_one_32(pattern->get_shot_count(), hash);
+
+        for (int j = 0; j != pattern->get_shot_count(); ++j) {
+            Shot* shot = pattern->get_shot(j);
+            ShotFrame* frame = shot->get_frame();
+
+            hash = hash_djb2_one_float(shot->get_position().x, hash);
+            hash = hash_djb2_one_float(shot->get_position().y, hash);
+            hash = hash_djb2_one_float(shot->get_direction().x, hash);
+            hash = hash_djb2_one_float(shot->get_direction().y, hash);
+            hash = hash_djb2_one_float(shot->get_speed(), hash);
+            hash = hash_djb2_one_float(frame->region.position.x, hash);
+            hash = hash_djb2_one_float(frame->region.position.y, hash);
+            hash = hash_djb2_one_32(frame->delay, hash);
+            hash = hash_djb2_one_32(shot->flagged(Shot::FLAG_CLEARED), hash);
+        }
+    }
+    return hash;
+}
+
+void DanmakuBenchmark::set_ticks(int p_ticks) {
+    ERR_FAIL_COND(p_ticks < 1);
+    ticks = p_ticks;
+}
+
+int DanmakuBenchmark::get_ticks() const {
+    return ticks;
+}
+
+void DanmakuBenchmark::set_golden_path(const String& p_path) {
+    golden_path = p_path;
+}
+
+String DanmakuBenchmark::get_golden_path() const {
+    return golden_path;
+}
+
+void DanmakuBenchmark::set_update_golden(bool p_update) {
+    update_golden = p_update;
+}
+
+bool DanmakuBenchmark::get_update_golden() const {
+    return update_golden;
+}
+
+void DanmakuBenchmark::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("run", "scenario"), &DanmakuBenchmark::run);
+    ClassDB::bind_method(D_METHOD("run_all"), &DanmakuBenchmark::run_all);
+    ClassDB::bind_method(D_METHOD("get_scenarios"), &DanmakuBenchmark::get_scenarios);
+
+    ClassDB::bind_method(D_METHOD("set_ticks", "ticks"), &DanmakuBenchmark::set_ticks);
+    ClassDB::bind_method(D_METHOD("set_golden_path", "path"), &DanmakuBenchmark::set_golden_path);
+    ClassDB::bind_method(D_METHOD("set_update_golden", "update"), &DanmakuBenchmark::set_update_golden);
+
+    ClassDB::bind_method(D_METHOD("get_ticks"), &DanmakuBenchmark::get_ticks);
+    ClassDB::bind_method(D_METHOD("get_golden_path"), &DanmakuBenchmark::get_golden_path);
+    ClassDB::bind_method(D_METHOD("get_update_golden"), &DanmakuBenchmark::get_update_golden);
+
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "ticks"), "set_ticks", "get_ticks");
+    ADD_PROPERTY(PropertyInfo(Variant::STRING, "golden_path", PROPERTY_HINT_FILE, "*.cfg"), "set_golden_path", "get_golden_path");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "update_golden"), "set_update_golden", "get_update_golden");
+}
+
+DanmakuBenchmark::DanmakuBenchmark() {
+    ticks = 600;
+    golden_path = "res://danmaku_benchmark.cfg";
+    update_golden = false;
+    danmaku = NULL;
+}
\ No newline at end of file
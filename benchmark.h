@@ -0,0 +1,77 @@
+// ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
+// *:･ﾟ✧ benchmark.hpp *:･ﾟ✧
+//
+// DanmakuBenchmark runs a set of canonical bullet hell scenarios headless, for a fixed number of
+// ticks each. Every scenario builds its own Danmaku, steps it by hand, and reports tick time
+// percentiles along with a checksum of the final state. Checksums are compared against a golden
+// file, so an optimization can be shown to be both faster and behavior-preserving. The goldens
+// live in danmaku_benchmark.cfg next to this file.
+//
+// effects and effects_interpreted run the same ShotEffect heavy scenario, the second with native
+// programs turned off. Their times compare the JIT (or ahead of time code) against the interpreter,
+// and their checksums should always agree.
+//
+// The node needs to be inside the scene tree, e.g. run from a scene with `godot --no-window`.
+// ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "scene/main/node.h"
+
+#include "danmaku.h"
+#include "pattern.h"
+#include "shot_effect.h"
+#include "shot_sprite.h"
+
+class DanmakuBenchmark : public Node {
+    GDCLASS(DanmakuBenchmark, Node);
+
+    int ticks;
+    String golden_path;
+    bool update_golden;
+
+    Danmaku* danmaku;
+    Vector<Pattern*> patterns;
+    Ref<ShotEffect> effect;
+
+protected:
+    static void _bind_methods();
+
+public:
+    enum Scenario {
+        SCENARIO_CIRCLE_SPAM,
+        SCENARIO_CURVING,
+        SCENARIO_BOMB,
+        SCENARIO_SPRITES,
+        SCENARIO_EFFECTS,
+        SCENARIO_EFFECTS_INTERPRETED,
+        SCENARIO_MAX
+    };
+
+    Dictionary run(const String& p_scenario);
+    Dictionary run_all();
+    PoolStringArray get_scenarios() const;
+
+    void set_ticks(int p_ticks);
+    int get_ticks() const;
+
+    void set_golden_path(const String& p_path);
+    String get_golden_path() const;
+
+    void set_update_golden(bool p_update);
+    bool get_update_golden() const;
+
+    DanmakuBenchmark();
+
+private:
+    void _setup(Scenario p_scenario);
+    void _step(Scenario p_scenario, int p_tick);
+    void _teardown();
+
+    Pattern* _add_pattern(const Vector2& p_position);
+    Ref<ShotSprite> _make_sprite(const String& p_key, int p_frames, bool p_clear);
+    uint32_t _checksum() const;
+};
+
+#endif
\ No newline at end of file
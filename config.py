@@ -2,4 +2,12 @@ def can_build(env, platform):
     return True
 
 def configure(env):
-    pass
\ No newline at end of file
+    pass
+
+def get_opts(platform):
+    from SCons.Variables import BoolVariable
+
+    return [
+        BoolVariable("kdanmaku_profiling", "Compile per-phase timing counters into kdanmaku", True),
+        BoolVariable("kdanmaku_jit", "Compile ShotEffects to machine code at runtime, on x86-64 Linux", False),
+    ]
\ No newline at end of file
@@ -0,0 +1,40 @@
+// ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
+// *:･ﾟ✧ counter_rng.hpp *:･ﾟ✧
+//
+// Counter-based random numbers. There is no generator state to advance: a number is a hash of a
+// key and a counter, so the same key and counter always give the same number, whatever order
+// they are asked for in. Danmaku derives a key for every shot from its seed, the firing Pattern's
+// seed and the volley, which keeps replays deterministic and lets shots draw numbers independently.
+// Patterns that should fire different numbers need different seeds.
+// ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
+
+#ifndef COUNTER_RNG_H
+#define COUNTER_RNG_H
+
+#include "core/typedefs.h"
+
+class CounterRNG {
+public:
+    // SplitMix64 finalizer
+    static _FORCE_INLINE_ uint64_t mix(uint64_t p_value) {
+        p_value = (p_value ^ (p_value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        p_value = (p_value ^ (p_value >> 27)) * 0x94D049BB133111EBULL;
+        return p_value ^ (p_value >> 31);
+    }
+
+    static _FORCE_INLINE_ uint64_t hash(uint64_t p_key, uint64_t p_counter) {
+        return mix(p_key ^ mix(p_counter + 0x9E3779B97F4A7C15ULL));
+    }
+
+    // Uniform in [0, 1), from the top 24 bits so every value is exact in a float
+    static _FORCE_INLINE_ float unit(uint64_t p_bits) {
+        return (p_bits >> 40) * (1.0f / 16777216.0f);
+    }
+
+    // Uniform in [-1, 1)
+    static _FORCE_INLINE_ float signed_unit(uint64_t p_bits) {
+        return unit(p_bits) * 2.0f - 1.0f;
+    }
+};
+
+#endif
\ No newline at end of file
@@ -1,7 +1,12 @@
 #include "danmaku.h"
 #include "pattern.h"
 #include "hitbox.h"
+#include "hurtbox.h"
+#include "laser.h"
 
+#include "core/os/os.h"
+#include "core/script_language.h"
+#include "servers/physics_2d_server.h"
 #include "servers/visual_server.h"
 
 #define MAX_SHOT_SPRITES 32
@@ -15,11 +20,18 @@ void Danmaku::_notification(int p_what) {
         } break;
 
         case NOTIFICATION_EXIT_TREE: {
+            if (print_pool_report) {
+                _print_pool_report();
+            }
             VS::get_singleton()->canvas_item_set_update_when_visible(get_canvas_item(), false);
             VS::get_singleton()->disconnect("frame_pre_draw", this, "_update_buffer");
             set_physics_process(false);
         } break;
 
+        case NOTIFICATION_PHYSICS_PROCESS: {
+            tick();
+        } break;
+
         case NOTIFICATION_DRAW: {
             RID atlas_rid;
             if (atlas.is_valid()) {
@@ -35,29 +47,287 @@ void Danmaku::add_pattern(Pattern* p_pattern) {
 }
 
 void Danmaku::remove_pattern(Pattern* p_pattern) {
+    record_pattern_peak(p_pattern);
     patterns.erase(p_pattern);
 }
 
 void Danmaku::add_hitbox(Hitbox* p_hitbox) {
-    hitbox = p_hitbox;
+    if (hitboxes.find(p_hitbox) != -1) {
+        return;
+    }
+
+    // Reuse the first free slot so that the slots of the other hitboxes don't change
+    int slot = hitboxes.find((Hitbox*)NULL);
+    if (slot == -1) {
+        ERR_FAIL_COND_MSG(hitboxes.size() >= MAX_HITBOXES, "Too many hitboxes, at most " + itos(MAX_HITBOXES) + " are supported.");
+        hitboxes.push_back(p_hitbox);
+    } else {
+        hitboxes.write[slot] = p_hitbox;
+    }
+    _update_hitbox_states();
 }
 
-void Danmaku::remove_hitbox() {
-    hitbox = NULL;
+void Danmaku::remove_hitbox(Hitbox* p_hitbox) {
+    int slot = hitboxes.find(p_hitbox);
+    if (slot == -1) {
+        return;
+    }
+    hitboxes.write[slot] = NULL;
+    while (!hitboxes.empty() && hitboxes[hitboxes.size() - 1] == NULL) {
+        hitboxes.resize(hitboxes.size() - 1);
+    }
+
+    // Whichever hitbox takes this slot next shouldn't inherit the shots already touching it
+    for (int i = 0; i != patterns.size(); ++i) {
+        for (int j = 0; j != patterns[i]->get_shot_count(); ++j) {
+            patterns[i]->get_shot(j)->forget_hitbox(1 << slot);
+        }
+    }
+    for (int i = 0; i != lasers.size(); ++i) {
+        lasers[i]->forget_hitbox(1 << slot);
+    }
+    _update_hitbox_states();
 }
 
 Hitbox* Danmaku::get_hitbox() const {
-    return hitbox;
+    for (int i = 0; i != hitboxes.size(); ++i) {
+        if (hitboxes[i]) {
+            return hitboxes[i];
+        }
+    }
+    return NULL;
+}
+
+Hitbox* Danmaku::get_hitbox_at(int p_slot) const {
+    if (p_slot < 0 || p_slot >= hitboxes.size()) {
+        return NULL;
+    }
+    return hitboxes[p_slot];
+}
+
+int Danmaku::get_hitbox_slot(const Hitbox* p_hitbox) const {
+    for (int i = 0; i != hitboxes.size(); ++i) {
+        if (hitboxes[i] == p_hitbox) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int Danmaku::get_hitbox_count() const {
+    int count = 0;
+    for (int i = 0; i != hitboxes.size(); ++i) {
+        if (hitboxes[i]) {
+            count++;
+        }
+    }
+    return count;
+}
+
+Hitbox* Danmaku::get_nearest_hitbox(const Vector2& p_position, uint32_t p_mask) const {
+    Hitbox* nearest = NULL;
+    float nearest_distance = 0;
+    for (int i = 0; i != hitboxes.size(); ++i) {
+        if (!hitboxes[i] || !(hitboxes[i]->get_layers() & p_mask)) {
+            continue;
+        }
+        float distance = hitboxes[i]->get_global_position().distance_squared_to(p_position);
+        if (!nearest || distance < nearest_distance) {
+            nearest = hitboxes[i];
+            nearest_distance = distance;
+        }
+    }
+    return nearest;
+}
+
+void Danmaku::add_laser(Laser* p_laser) {
+    if (lasers.find(p_laser) == -1) {
+        lasers.push_back(p_laser);
+    }
+}
+
+void Danmaku::remove_laser(Laser* p_laser) {
+    lasers.erase(p_laser);
+}
+
+int Danmaku::get_laser_count() const {
+    return lasers.size();
+}
+
+void Danmaku::add_hurtbox(Hurtbox* p_hurtbox) {
+    if (hurtboxes.find(p_hurtbox) == -1) {
+        hurtboxes.push_back(p_hurtbox);
+    }
+}
+
+void Danmaku::remove_hurtbox(Hurtbox* p_hurtbox) {
+    hurtboxes.erase(p_hurtbox);
+
+    // Drop it from this tick's grid too, in case it leaves the tree while patterns are ticking
+    for (int i = 0; i != hurtbox_states.size(); ++i) {
+        if (hurtbox_states[i].hurtbox == p_hurtbox) {
+            hurtbox_states.write[i].layers = 0;
+        }
+    }
+}
+
+int Danmaku::get_hurtbox_count() const {
+    return hurtboxes.size();
+}
+
+void Danmaku::_update_hurtbox_states() {
+    hurtbox_states.clear();
+    hurtbox_grid.clear(region.grow(tolerance), broadphase_cell_size);
+
+    for (int i = 0; i != hurtboxes.size(); ++i) {
+        HurtboxState state;
+        state.hurtbox = hurtboxes[i];
+        state.position = hurtboxes[i]->get_global_transform().get_origin();
+        state.radius = hurtboxes[i]->get_radius();
+        state.layers = hurtboxes[i]->get_layers();
+        hurtbox_states.push_back(state);
+
+        Vector2 extents = Vector2(state.radius, state.radius);
+        hurtbox_grid.add(Rect2(state.position - extents, extents * 2));
+    }
+    hurtbox_grid.build();
+}
+
+void Danmaku::_resolve_cancels() {
+    uint32_t cancelling = 0;
+    for (int i = 0; i != patterns.size(); ++i) {
+        cancelling |= patterns[i]->get_cancel_mask();
+    }
+    if (!cancelling) {
+        return;
+    }
+
+    DANMAKU_PROFILE_BEGIN(cancel_begin);
+
+    // Every shot that something can cancel goes in the grid, then each cancelling shot looks up its cells
+    cancel_grid.clear(region.grow(tolerance), broadphase_cell_size);
+    cancel_shots.clear();
+    for (int i = 0; i != patterns.size(); ++i) {
+        Pattern* pattern = patterns[i];
+        if (!(pattern->get_cancel_layer() & cancelling)) {
+            continue;
+        }
+        for (int j = 0; j != pattern->get_shot_count(); ++j) {
+            Shot* shot = pattern->get_shot(j);
+            if (shot->flagged(Shot::FLAG_ACTIVE) && !shot->flagged(Shot::FLAG_CLEARED)) {
+                float radius = shot->get_radius();
+                cancel_grid.add(Rect2(shot->get_global_position() - Vector2(radius, radius), Vector2(radius, radius) * 2));
+                cancel_shots.push_back(shot);
+            }
+        }
+    }
+    cancel_grid.build();
+
+    for (int i = 0; i != patterns.size(); ++i) {
+        Pattern* pattern = patterns[i];
+        uint32_t mask = pattern->get_cancel_mask();
+        if (!mask) {
+            continue;
+        }
+
+        for (int j = 0; j != pattern->get_shot_count(); ++j) {
+            Shot* shot = pattern->get_shot(j);
+            if (!shot->flagged(Shot::FLAG_ACTIVE) || shot->flagged(Shot::FLAG_CLEARED)) {
+                continue;
+            }
+
+            Vector2 position = shot->get_global_position();
+            float radius = shot->get_radius();
+
+            cancel_grid.query(Rect2(position - Vector2(radius, radius), Vector2(radius, radius) * 2), [&](int p_item) {
+                Shot* other = cancel_shots[p_item];
+                Pattern* owner = other->get_pattern();
+                if (other == shot || other->flagged(Shot::FLAG_CLEARED) || !(owner->get_cancel_layer() & mask)) {
+                    return true;
+                }
+                float reach = radius + other->get_radius();
+                if (position.distance_squared_to(other->get_global_position()) > reach * reach) {
+                    return true;
+                }
+                other->clear();
+
+                // Groups that cancel each other both lose their shots, a bomb that only cancels survives
+                if (owner->get_cancel_mask() & pattern->get_cancel_layer()) {
+                    shot->clear();
+                    return false;
+                }
+                return true;
+            });
+        }
+    }
+
+    DANMAKU_PROFILE_END(cancel_begin, this, PHASE_CANCELLATION);
+}
+
+void Danmaku::_update_hitbox_states() {
+    hitbox_states.clear();
+
+    for (int i = 0; i != hitboxes.size(); ++i) {
+        Hitbox* hitbox = hitboxes[i];
+        if (!hitbox) {
+            continue;
+        }
+
+        HitboxState state;
+        state.hitbox = hitbox;
+        state.position = hitbox->get_global_transform().get_origin();
+        state.collision_radius = hitbox->get_collision_radius();
+        state.graze_radius = hitbox->get_graze_radius();
+        state.layers = hitbox->get_layers();
+        state.bit = 1 << i;
+        state.reach = MAX(state.collision_radius, state.graze_radius);
+        hitbox_states.push_back(state);
+    }
 }
 
 Shot* Danmaku::capture() {
+    if (free_shots.empty()) {
+        pool_stats.denied++;
+        return NULL;
+    }
+
     Shot* shot = free_shots[free_shots.size() - 1];
     free_shots.remove(free_shots.size() - 1);
+    shot->set_spawn_tick(current_tick);
+
+    pool_stats.captures++;
+    shot_grid_dirty = true;
+    pool_stats.high_water = MAX(pool_stats.high_water, max_shots - free_shots.size());
     return shot;
 }
 
+int Danmaku::capture(int p_count, Vector<Shot*>& r_shots) {
+    // Takes as many shots as are free off the end of the pool at once, the rest are denied
+    int captured = MIN(p_count, free_shots.size());
+    int first = free_shots.size() - captured;
+    r_shots.resize(captured);
+    for (int i = 0; i != captured; ++i) {
+        Shot* shot = free_shots[first + i];
+        shot->set_spawn_tick(current_tick);
+        r_shots.write[i] = shot;
+    }
+    free_shots.resize(first);
+
+    pool_stats.captures += captured;
+    pool_stats.denied += p_count - captured;
+    if (captured) {
+        shot_grid_dirty = true;
+    }
+    pool_stats.high_water = MAX(pool_stats.high_water, max_shots - free_shots.size());
+    return captured;
+}
+
 void Danmaku::release(Shot* p_shot) {
     free_shots.push_back(p_shot);
+
+    pool_stats.releases++;
+    shot_grid_dirty = true;
+    pool_stats.total_lifetime += current_tick - p_shot->get_spawn_tick();
 }
 
 Ref<ShotSprite> Danmaku::get_sprite(const String& p_key) const {
@@ -77,6 +347,137 @@ void Danmaku::clear_all() {
     }
 }
 
+void Danmaku::_update_shot_grid() {
+    if (!shot_grid_dirty) {
+        return;
+    }
+    shot_grid_dirty = false;
+
+    shot_grid.clear(region.grow(tolerance), broadphase_cell_size);
+    grid_shots.clear();
+    for (int i = 0; i != patterns.size(); ++i) {
+        Pattern* pattern = patterns[i];
+        for (int j = 0; j != pattern->get_shot_count(); ++j) {
+            Shot* shot = pattern->get_shot(j);
+            if (shot->flagged(Shot::FLAG_ACTIVE) && !shot->flagged(Shot::FLAG_CLEARED)) {
+                float radius = shot->get_radius();
+                shot_grid.add(Rect2(shot->get_global_position() - Vector2(radius, radius), Vector2(radius, radius) * 2));
+                grid_shots.push_back(shot);
+            }
+        }
+    }
+    shot_grid.build();
+}
+
+Array Danmaku::query_circle(const Vector2& p_center, float p_radius) {
+    _update_shot_grid();
+
+    Array result;
+    Rect2 area = Rect2(p_center - Vector2(p_radius, p_radius), Vector2(p_radius, p_radius) * 2);
+    shot_grid.query(area, [&](int p_item) {
+        const Rect2& rect = shot_grid.get_item_rect(p_item);
+        float reach = p_radius + rect.size.x / 2;
+        if ((rect.position + rect.size / 2).distance_squared_to(p_center) <= reach * reach) {
+            result.push_back((int64_t)grid_shots[p_item]->get_instance_id());
+        }
+        return true;
+    });
+    return result;
+}
+
+Array Danmaku::query_rect(const Rect2& p_rect) {
+    _update_shot_grid();
+
+    Array result;
+    shot_grid.query(p_rect, [&](int p_item) {
+        const Rect2& rect = shot_grid.get_item_rect(p_item);
+        Vector2 center = rect.position + rect.size / 2;
+        Vector2 closest = Vector2(
+                CLAMP(center.x, p_rect.position.x, p_rect.position.x + p_rect.size.x),
+                CLAMP(center.y, p_rect.position.y, p_rect.position.y + p_rect.size.y));
+        float radius = rect.size.x / 2;
+        if (closest.distance_squared_to(center) <= radius * radius) {
+            result.push_back((int64_t)grid_shots[p_item]->get_instance_id());
+        }
+        return true;
+    });
+    return result;
+}
+
+int64_t Danmaku::nearest_shot(const Vector2& p_position, float p_max_distance) {
+    _update_shot_grid();
+    if (shot_grid.empty()) {
+        return 0;
+    }
+
+    // Search outwards a cell at a time until a shot turns up within the searched radius
+    float limit = p_max_distance > 0 ? p_max_distance : region.grow(tolerance).size.length() * 2;
+    float radius = MIN(broadphase_cell_size, limit);
+    while (true) {
+        int nearest = -1;
+        float nearest_distance = radius * radius;
+
+        Rect2 area = Rect2(p_position - Vector2(radius, radius), Vector2(radius, radius) * 2);
+        shot_grid.query(area, [&](int p_item) {
+            const Rect2& rect = shot_grid.get_item_rect(p_item);
+            float distance = (rect.position + rect.size / 2).distance_squared_to(p_position);
+            if (distance <= nearest_distance) {
+                nearest = p_item;
+                nearest_distance = distance;
+            }
+            return true;
+        });
+
+        if (nearest != -1) {
+            return grid_shots[nearest]->get_instance_id();
+        }
+        if (radius >= limit) {
+            return 0;
+        }
+        radius = MIN(radius * 2, limit);
+    }
+}
+
+Array Danmaku::raycast(const Vector2& p_from, const Vector2& p_to, float p_width) {
+    _update_shot_grid();
+
+    struct Hit {
+        float t;
+        ObjectID shot;
+        bool operator<(const Hit& p_other) const { return t < p_other.t; }
+    };
+    Vector<Hit> hits;
+
+    Vector2 ray = p_to - p_from;
+    float length_squared = ray.length_squared();
+    float half_width = p_width / 2;
+
+    Rect2 area = Rect2(p_from, Vector2()).expand(p_to).grow(half_width);
+    shot_grid.query(area, [&](int p_item) {
+        const Rect2& rect = shot_grid.get_item_rect(p_item);
+        Vector2 center = rect.position + rect.size / 2;
+
+        float t = length_squared > 0 ? CLAMP((center - p_from).dot(ray) / length_squared, 0, 1) : 0;
+        float reach = half_width + rect.size.x / 2;
+        if ((p_from + ray * t).distance_squared_to(center) <= reach * reach) {
+            Hit hit;
+            hit.t = t;
+            hit.shot = grid_shots[p_item]->get_instance_id();
+            hits.push_back(hit);
+        }
+        return true;
+    });
+
+    // Nearest to the start of the ray first
+    hits.sort();
+    Array result;
+    result.resize(hits.size());
+    for (int i = 0; i != hits.size(); ++i) {
+        result[i] = (int64_t)hits[i].shot;
+    }
+    return result;
+}
+
 void Danmaku::clear_circle(Vector2 p_origin, float p_radius) {
     for (int i = 0; i != patterns.size(); ++i) {
         Transform2D transform = patterns[i]->get_global_transform();
@@ -109,8 +510,33 @@ void Danmaku::set_max_shots(int p_max_shots) {
         free_shots.write[i] = memnew(Shot);
     }
 
-    VS::get_singleton()->multimesh_allocate(multimesh, max_shots, VS::MULTIMESH_TRANSFORM_2D, VS::MULTIMESH_COLOR_NONE, VS::MULTIMESH_CUSTOM_DATA_FLOAT);
-    buffer.resize((8 + 4) * max_shots);
+    _allocate_buffer();
+}
+
+void Danmaku::set_max_laser_segments(int p_max_laser_segments) {
+    ERR_FAIL_COND(p_max_laser_segments < 0);
+    max_laser_segments = p_max_laser_segments;
+    _allocate_buffer();
+}
+
+int Danmaku::get_max_laser_segments() const {
+    return max_laser_segments;
+}
+
+void Danmaku::_allocate_buffer() {
+    // Every shot and every laser segment is one instance
+    int instances = max_shots + max_laser_segments;
+    VS::get_singleton()->multimesh_allocate(multimesh, instances, VS::MULTIMESH_TRANSFORM_2D, VS::MULTIMESH_COLOR_NONE, VS::MULTIMESH_CUSTOM_DATA_FLOAT);
+    buffer.resize((8 + 4) * instances);
+}
+
+void Danmaku::set_sfx_cooldowns(const Dictionary& p_cooldowns) {
+    sfx_cooldowns = p_cooldowns.duplicate();
+    sfx_ready.clear();
+}
+
+Dictionary Danmaku::get_sfx_cooldowns() const {
+    return sfx_cooldowns;
 }
 
 int Danmaku::get_max_shots() const {
@@ -130,19 +556,489 @@ int Danmaku::get_pattern_count() const {
 }
 
 void Danmaku::play_sfx(const StringName& p_key) {
-    emit_signal("play_sfx", p_key);
+    if (advancing) {
+        return;
+    }
+    if (!ticking) {
+        _emit_sfx(p_key, 1);
+        return;
+    }
+
+    // There are only ever a handful of distinct keys per tick, a linear search beats hashing
+    for (int i = 0; i != sfx_queue.size(); ++i) {
+        if (sfx_queue[i].key == p_key) {
+            sfx_queue.write[i].count++;
+            return;
+        }
+    }
+    SfxRequest request;
+    request.key = p_key;
+    request.count = 1;
+    sfx_queue.push_back(request);
+}
+
+void Danmaku::set_sfx_cooldown(const StringName& p_key, int p_frames) {
+    if (p_frames <= 0) {
+        sfx_cooldowns.erase(String(p_key));
+    } else {
+        sfx_cooldowns[String(p_key)] = p_frames;
+    }
+}
+
+int Danmaku::get_sfx_cooldown(const StringName& p_key) const {
+    return sfx_cooldowns.get(String(p_key), 0);
+}
+
+void Danmaku::_emit_sfx(const StringName& p_key, int p_count) {
+    int cooldown = get_sfx_cooldown(p_key);
+    if (cooldown > 0) {
+        const uint64_t* ready = sfx_ready.getptr(p_key);
+        if (ready && *ready > current_tick) {
+            return;
+        }
+        sfx_ready[p_key] = current_tick + cooldown;
+    }
+    emit_signal("play_sfx", p_key, p_count);
+}
+
+void Danmaku::_flush_sfx() {
+    // Listeners may request more sfx while handling these, which then go out immediately
+    Vector<SfxRequest> queue = sfx_queue;
+    sfx_queue.clear();
+    for (int i = 0; i != queue.size(); ++i) {
+        _emit_sfx(queue[i].key, queue[i].count);
+    }
+}
+
+void Danmaku::tick() {
+    current_tick++;
+    timers.advance();
+
+    // Captures and releases since the last tick are attributed to the tick that just ended
+    pool_stats.peak_captures = MAX(pool_stats.peak_captures, pool_stats.captures);
+    pool_stats.peak_releases = MAX(pool_stats.peak_releases, pool_stats.releases);
+    pool_stats.peak_demand = MAX(pool_stats.peak_demand, get_active_shot_count() + pool_stats.denied);
+    pool_stats.total_captures += pool_stats.captures;
+    pool_stats.total_releases += pool_stats.releases;
+    pool_stats.total_denied += pool_stats.denied;
+    pool_stats.captures = 0;
+    pool_stats.releases = 0;
+    pool_stats.denied = 0;
+    pool_stats.ticks++;
+
+#ifdef KDANMAKU_PROFILING
+    // The previous tick's numbers include the _update_buffer call that followed it
+    for (int i = 0; i != PHASE_MAX; ++i) {
+        last_phase_time[i] = phase_time[i];
+        total_phase_time[i] += phase_time[i];
+        phase_time[i] = 0;
+    }
+    _report_profiling();
+#endif
+
+    if (static_walls && walls_dirty) {
+        _bake_walls();
+    }
+
+    _update_hitbox_states();
+    for (int i = 0; i != hitbox_states.size(); ++i) {
+        hitbox_states[i].hitbox->clear_events();
+    }
+    _update_hurtbox_states();
+    for (int i = 0; i != hurtbox_states.size(); ++i) {
+        hurtbox_states[i].hurtbox->clear_events();
+    }
+
+    // Signal callbacks may add or remove Patterns and Lasers mid-tick. Walk a copy, and skip any
+    // that left since, which may already be freed. Ones added mid-tick start next tick.
+    ticking = true;
+    Vector<Pattern*> ticked = patterns;
+    for (int i = 0; i != ticked.size(); ++i) {
+        if (patterns.find(ticked[i]) != -1) {
+            ticked[i]->_tick();
+        }
+    }
+    Vector<Laser*> ticked_lasers = lasers;
+    for (int i = 0; i != ticked_lasers.size(); ++i) {
+        if (lasers.find(ticked_lasers[i]) != -1) {
+            ticked_lasers[i]->_tick();
+        }
+    }
+    ticking = false;
+
+    _resolve_cancels();
+    shot_grid_dirty = true;
+
+    // Fast forwarding keeps hit counts and damage but emits nothing, no script should react while seeking
+    if (advancing) {
+        sfx_queue.clear();
+    } else {
+        // Hitboxes may leave the tree from their signal callbacks, and be freed, so skip any that left since
+        Vector<HitboxState> flushed = hitbox_states;
+        for (int i = 0; i != flushed.size(); ++i) {
+            if (hitboxes.find(flushed[i].hitbox) != -1) {
+                flushed[i].hitbox->flush_events();
+            }
+        }
+        Vector<Hurtbox*> damaged = hurtboxes;
+        for (int i = 0; i != damaged.size(); ++i) {
+            if (hurtboxes.find(damaged[i]) != -1) {
+                damaged[i]->flush_events();
+            }
+        }
+        _flush_sfx();
+    }
+
+    if (tracer.is_active()) {
+        tracer.counter(trace_active_shots, OS::get_singleton()->get_ticks_usec(), get_active_shot_count());
+    }
+}
+
+uint64_t Danmaku::get_tick() const {
+    return current_tick;
+}
+
+void Danmaku::advance(int p_ticks) {
+    // A script under the Danmaku that advances from its own _physics_process is stepped again by every
+    // advanced tick, its nested calls have nothing left to do
+    if (advancing) {
+        return;
+    }
+    ERR_FAIL_COND(p_ticks < 0);
+
+    // Nothing is drawn until the next frame, so the buffer is only filled once at the end
+    advancing = true;
+    for (int i = 0; i != p_ticks; ++i) {
+        tick();
+        _propagate_physics_process(this);
+    }
+    advancing = false;
+
+    // The last tick's events were never signalled, don't leave them around to be read as if they had been
+    for (int i = 0; i != hitboxes.size(); ++i) {
+        if (hitboxes[i]) {
+            hitboxes[i]->clear_events();
+        }
+    }
+    for (int i = 0; i != hurtboxes.size(); ++i) {
+        hurtboxes[i]->clear_events();
+    }
+}
+
+bool Danmaku::is_advancing() const {
+    return advancing;
+}
+
+void Danmaku::_propagate_physics_process(Node* p_node) {
+    // Same order the scene tree uses: Danmaku itself goes first, then its descendants in tree order.
+    // Only scripts are stepped, internal processing (bodies, animation players...) needs the physics
+    // server to have stepped too, and paused nodes stay paused.
+    for (int i = 0; i < p_node->get_child_count(); ++i) {
+        Node* child = p_node->get_child(i);
+        if (child->is_physics_processing() && child->can_process()) {
+            child->notification(NOTIFICATION_PHYSICS_PROCESS);
+        }
+        if (child->is_inside_tree() && child->get_parent() == p_node) {
+            _propagate_physics_process(child);
+        }
+    }
+}
+
+void Danmaku::bake_walls() {
+    // The physics space can only be queried safely while physics is processing, so bake next tick
+    walls_dirty = true;
+}
+
+Vector2 Danmaku::get_wall_normal(const Vector2& p_position, uint32_t p_mask) const {
+    // The grid has no surfaces, so estimate which way is out from which neighbouring cells are solid
+    Vector2 normal;
+    if (get_wall_mask(p_position - Vector2(wall_cell_size, 0)) & p_mask) normal.x += 1;
+    if (get_wall_mask(p_position + Vector2(wall_cell_size, 0)) & p_mask) normal.x -= 1;
+    if (get_wall_mask(p_position - Vector2(0, wall_cell_size)) & p_mask) normal.y += 1;
+    if (get_wall_mask(p_position + Vector2(0, wall_cell_size)) & p_mask) normal.y -= 1;
+    return normal.normalized();
+}
+
+void Danmaku::_bake_walls() {
+    walls_dirty = false;
+    walls_rect = region;
+    walls_width = MAX(1, (int)Math::ceil(region.size.width / wall_cell_size));
+    walls_height = MAX(1, (int)Math::ceil(region.size.height / wall_cell_size));
+    walls.resize(walls_width * walls_height);
+
+    Physics2DDirectSpaceState* ss = get_world_2d()->get_direct_space_state();
+    ERR_FAIL_NULL(ss);
+
+    // Each cell keeps the layers of every body found at its center
+    const int MAX_RESULTS = 8;
+    Physics2DDirectSpaceState::ShapeResult results[MAX_RESULTS];
+
+    uint32_t* w = walls.ptrw();
+    for (int y = 0; y != walls_height; ++y) {
+        for (int x = 0; x != walls_width; ++x) {
+            Vector2 center = walls_rect.position + Vector2(x + 0.5, y + 0.5) * wall_cell_size;
+            int found = ss->intersect_point(center, results, MAX_RESULTS);
+
+            uint32_t mask = 0;
+            for (int i = 0; i != found; ++i) {
+                mask |= Physics2DServer::get_singleton()->body_get_collision_layer(results[i].rid);
+            }
+            w[y * walls_width + x] = mask;
+        }
+    }
+}
+
+int64_t Danmaku::schedule(int p_frames, Object* p_target, const StringName& p_method) {
+    return timers.schedule(p_frames, p_target, p_method);
+}
+
+void Danmaku::cancel(int64_t p_timer) {
+    timers.cancel(p_timer);
+}
+
+int Danmaku::get_frames_left(int64_t p_timer) const {
+    return timers.get_ticks_left(p_timer);
+}
+
+void Danmaku::record_pattern_peak(Pattern* p_pattern) {
+    String key = p_pattern->is_inside_tree() ? String(p_pattern->get_path()) : String(p_pattern->get_name());
+    int peak = p_pattern->get_peak_shot_count();
+    if (peak > (int)pool_stats.pattern_peaks.get(key, 0)) {
+        pool_stats.pattern_peaks[key] = peak;
+    }
+}
+
+Dictionary Danmaku::get_pool_report() {
+    for (int i = 0; i != patterns.size(); ++i) {
+        record_pattern_peak(patterns[i]);
+    }
+
+    uint64_t captures = pool_stats.total_captures + pool_stats.captures;
+    uint64_t releases = pool_stats.total_releases + pool_stats.releases;
+    uint64_t denied = pool_stats.total_denied + pool_stats.denied;
+    uint64_t ticks = MAX(pool_stats.ticks, (uint64_t)1);
+
+    // Leave 10% headroom over the worst tick's demand, rounded up to a multiple of 64
+    int demand = MAX(pool_stats.peak_demand, pool_stats.high_water);
+    int recommended = MAX(((demand + demand / 10 + 63) / 64) * 64, 64);
+
+    Dictionary report;
+    report["max_shots"] = max_shots;
+    report["active_shots"] = get_active_shot_count();
+    report["free_shots"] = get_free_shot_count();
+    report["high_water"] = pool_stats.high_water;
+    report["ticks"] = pool_stats.ticks;
+    report["captures"] = captures;
+    report["releases"] = releases;
+    report["denied_captures"] = denied;
+    report["captures_per_tick"] = (double)captures / ticks;
+    report["releases_per_tick"] = (double)releases / ticks;
+    report["peak_captures_per_tick"] = pool_stats.peak_captures;
+    report["peak_releases_per_tick"] = pool_stats.peak_releases;
+    report["average_lifetime"] = releases ? (double)pool_stats.total_lifetime / releases : 0.0;
+    report["pattern_peaks"] = pool_stats.pattern_peaks.duplicate();
+    report["recommended_max_shots"] = recommended;
+    return report;
+}
+
+void Danmaku::reset_pool_report() {
+    pool_stats.high_water = get_active_shot_count();
+    pool_stats.captures = 0;
+    pool_stats.releases = 0;
+    pool_stats.denied = 0;
+    pool_stats.peak_captures = 0;
+    pool_stats.peak_releases = 0;
+    pool_stats.peak_demand = 0;
+    pool_stats.total_captures = 0;
+    pool_stats.total_releases = 0;
+    pool_stats.total_denied = 0;
+    pool_stats.total_lifetime = 0;
+    pool_stats.ticks = 0;
+    pool_stats.pattern_peaks.clear();
+    for (int i = 0; i != patterns.size(); ++i) {
+        patterns[i]->reset_peak_shot_count();
+    }
+}
+
+void Danmaku::_print_pool_report() {
+    Dictionary report = get_pool_report();
+    String stage = get_owner() ? get_owner()->get_filename() : get_filename();
+    if (stage.empty()) {
+        stage = get_name();
+    }
+
+    print_line("Danmaku pool report for " + stage + ":");
+    print_line("    max_shots " + itos(max_shots) + ", high water " + itos(report["high_water"]) + ", denied captures " + itos(report["denied_captures"]));
+    print_line("    " + rtos(report["captures_per_tick"]) + " captures/tick, " + rtos(report["releases_per_tick"]) + " releases/tick, average lifetime " + rtos(report["average_lifetime"]) + " ticks");
+
+    Dictionary peaks = report["pattern_peaks"];
+    for (int i = 0; i != peaks.size(); ++i) {
+        print_line("    " + String(peaks.get_key_at_index(i)) + ": peak " + itos(peaks.get_value_at_index(i)) + " shots");
+    }
+
+    int recommended = report["recommended_max_shots"];
+    if (recommended != max_shots) {
+        print_line("    Recommended max_shots: " + itos(recommended));
+    }
+}
+
+void Danmaku::set_print_pool_report(bool p_print) {
+    print_pool_report = p_print;
+}
+
+bool Danmaku::get_print_pool_report() const {
+    return print_pool_report;
+}
+
+uint64_t Danmaku::get_monitor(Phase p_phase) const {
+    ERR_FAIL_INDEX_V(p_phase, PHASE_MAX, 0);
+    return last_phase_time[p_phase];
+}
+
+uint64_t Danmaku::get_monitor_total(Phase p_phase) const {
+    ERR_FAIL_INDEX_V(p_phase, PHASE_MAX, 0);
+    return total_phase_time[p_phase];
+}
+
+void Danmaku::reset_monitors() {
+    for (int i = 0; i != PHASE_MAX; ++i) {
+        phase_time[i] = 0;
+        last_phase_time[i] = 0;
+        total_phase_time[i] = 0;
+    }
+    for (int i = 0; i != patterns.size(); ++i) {
+        patterns[i]->reset_tick_time();
+    }
+}
+
+void Danmaku::start_trace(int p_capacity) {
+#ifdef KDANMAKU_PROFILING
+    tracer.start(p_capacity);
+#else
+    WARN_PRINT("Tracing is unavailable, kdanmaku was built without profiling.");
+#endif
+}
+
+void Danmaku::stop_trace() {
+    tracer.stop();
+}
+
+Error Danmaku::flush_trace(const String& p_path) {
+    ERR_FAIL_COND_V_MSG(!tracer.is_active(), ERR_UNCONFIGURED, "Call start_trace() before flushing a trace.");
+    return tracer.flush(p_path);
+}
+
+bool Danmaku::is_tracing() const {
+    return tracer.is_active();
+}
+
+void Danmaku::set_effect_profiling(bool p_profiling) {
+    ShotEffect::set_profiling(p_profiling);
+}
+
+bool Danmaku::is_effect_profiling() const {
+    return ShotEffect::is_profiling();
+}
+
+void Danmaku::reset_effect_profile() {
+    ShotEffect::reset_profile();
+}
+
+Array Danmaku::get_effect_profile() const {
+    return ShotEffect::get_profile();
+}
+
+String Danmaku::get_effect_profile_table() const {
+    return ShotEffect::get_profile_table();
+}
+
+Error Danmaku::export_effect_profile(const String& p_path) const {
+    return ShotEffect::export_profile(p_path);
+}
+
+void Danmaku::_report_profiling() {
+    // Godot 3's Performance singleton has no custom monitors, so feed the editor's profiler instead
+    ScriptDebugger* debugger = ScriptDebugger::get_singleton();
+    if (!debugger || !debugger->is_profiling()) {
+        return;
+    }
+
+    Array phases;
+    for (int i = 0; i != PHASE_MAX; ++i) {
+        phases.push_back(String(phase_names[i]).capitalize());
+        phases.push_back(last_phase_time[i] / 1000000.0);
+    }
+    debugger->add_profiling_frame_data("danmaku_phases", phases);
+
+    Array pattern_times;
+    for (int i = 0; i != patterns.size(); ++i) {
+        pattern_times.push_back(patterns[i]->get_path());
+        pattern_times.push_back(patterns[i]->get_tick_time() / 1000000.0);
+    }
+    debugger->add_profiling_frame_data("danmaku_patterns", pattern_times);
 }
 
 void Danmaku::set_region(const Rect2& p_region) {
     region = p_region;
+    walls_dirty = true;
+    for (int i = 0; i != patterns.size(); ++i) {
+        patterns[i]->invalidate_expire_ticks();
+    }
 }
 
 Rect2 Danmaku::get_region() const {
     return region;
 }
 
+void Danmaku::set_static_walls(bool p_static_walls) {
+    static_walls = p_static_walls;
+    walls_dirty = true;
+    if (!static_walls) {
+        walls.clear();
+        walls_width = 0;
+        walls_height = 0;
+    }
+}
+
+bool Danmaku::has_static_walls() const {
+    return static_walls;
+}
+
+void Danmaku::set_wall_cell_size(float p_size) {
+    ERR_FAIL_COND(p_size <= 0);
+    wall_cell_size = p_size;
+    walls_dirty = true;
+}
+
+float Danmaku::get_wall_cell_size() const {
+    return wall_cell_size;
+}
+
+void Danmaku::set_broadphase_cell_size(float p_size) {
+    ERR_FAIL_COND(p_size <= 0);
+    broadphase_cell_size = p_size;
+}
+
+float Danmaku::get_broadphase_cell_size() const {
+    return broadphase_cell_size;
+}
+
+void Danmaku::set_seed(int64_t p_seed) {
+    seed = p_seed;
+    for (int i = 0; i != patterns.size(); ++i) {
+        patterns[i]->update_seed_key();
+    }
+}
+
+int64_t Danmaku::get_seed() const {
+    return seed;
+}
+
 void Danmaku::set_tolerance(float p_tolerance) {
     tolerance = p_tolerance;
+    for (int i = 0; i != patterns.size(); ++i) {
+        patterns[i]->invalidate_expire_ticks();
+    }
 }
 
 float Danmaku::get_tolerance() const {
@@ -188,6 +1084,7 @@ void Danmaku::_validate_property(PropertyInfo& property) const {
 }
 
 void Danmaku::_update_buffer() {
+    DANMAKU_PROFILE_BEGIN(update_begin);
     PoolRealArray::Write write = buffer.write();
     real_t* buf = write.ptr();
     int visible = 0;
@@ -195,9 +1092,15 @@ void Danmaku::_update_buffer() {
     for (int i = 0; i != patterns.size(); ++i) {
         visible += patterns[i]->fill_buffer(buf);
     }
+    int segments = 0;
+    for (int i = 0; i != lasers.size(); ++i) {
+        segments += lasers[i]->fill_buffer(buf, max_laser_segments - segments);
+    }
+    visible += segments;
 
     VS::get_singleton()->multimesh_set_as_bulk_array(multimesh, buffer);
     VS::get_singleton()->multimesh_set_visible_instances(multimesh, visible);
+    DANMAKU_PROFILE_END(update_begin, this, PHASE_UPDATE_BUFFER);
 }
 
 void Danmaku::_create_mesh() {
@@ -253,8 +1156,19 @@ void Danmaku::_create_material() {
 }
 
 void Danmaku::_destroy() {
-    if (hitbox) {
-        hitbox->remove_from_danmaku();
+    while (!hitboxes.empty()) {
+        Hitbox* hitbox = hitboxes[hitboxes.size() - 1];
+        if (hitbox) {
+            hitbox->remove_from_danmaku();
+        } else {
+            hitboxes.resize(hitboxes.size() - 1);
+        }
+    }
+    while (!lasers.empty()) {
+        lasers[lasers.size() - 1]->remove_from_danmaku();
+    }
+    while (!hurtboxes.empty()) {
+        hurtboxes[hurtboxes.size() - 1]->remove_from_danmaku();
     }
     for (int i = 0; i != patterns.size(); ++i) {
         patterns[i]->remove_from_danmaku();
@@ -272,39 +1186,111 @@ void Danmaku::_bind_methods() {
     ClassDB::bind_method(D_METHOD("clear_circle"), &Danmaku::clear_circle);
     ClassDB::bind_method(D_METHOD("clear_rect"), &Danmaku::clear_rect);
 
+    ClassDB::bind_method(D_METHOD("query_circle", "center", "radius"), &Danmaku::query_circle);
+    ClassDB::bind_method(D_METHOD("query_rect", "rect"), &Danmaku::query_rect);
+    ClassDB::bind_method(D_METHOD("nearest_shot", "position", "max_distance"), &Danmaku::nearest_shot, DEFVAL(0));
+    ClassDB::bind_method(D_METHOD("raycast", "from", "to", "width"), &Danmaku::raycast, DEFVAL(0));
+
     ClassDB::bind_method(D_METHOD("play_sfx", "key"), &Danmaku::play_sfx);
+    ClassDB::bind_method(D_METHOD("set_sfx_cooldown", "key", "frames"), &Danmaku::set_sfx_cooldown);
+    ClassDB::bind_method(D_METHOD("get_sfx_cooldown", "key"), &Danmaku::get_sfx_cooldown);
     
     ClassDB::bind_method(D_METHOD("get_free_shot_count"), &Danmaku::get_free_shot_count);
     ClassDB::bind_method(D_METHOD("get_active_shot_count"), &Danmaku::get_active_shot_count);
     ClassDB::bind_method(D_METHOD("get_pattern_count"), &Danmaku::get_pattern_count);
 
+    ClassDB::bind_method(D_METHOD("get_hitbox"), &Danmaku::get_hitbox);
+    ClassDB::bind_method(D_METHOD("get_hitbox_at", "slot"), &Danmaku::get_hitbox_at);
+    ClassDB::bind_method(D_METHOD("get_hitbox_count"), &Danmaku::get_hitbox_count);
+    ClassDB::bind_method(D_METHOD("get_hurtbox_count"), &Danmaku::get_hurtbox_count);
+    ClassDB::bind_method(D_METHOD("get_laser_count"), &Danmaku::get_laser_count);
+
+    ClassDB::bind_method(D_METHOD("get_tick"), &Danmaku::get_tick);
+    ClassDB::bind_method(D_METHOD("advance", "ticks"), &Danmaku::advance);
+    ClassDB::bind_method(D_METHOD("is_advancing"), &Danmaku::is_advancing);
+    ClassDB::bind_method(D_METHOD("schedule", "frames", "target", "method"), &Danmaku::schedule);
+    ClassDB::bind_method(D_METHOD("cancel", "timer"), &Danmaku::cancel);
+    ClassDB::bind_method(D_METHOD("get_frames_left", "timer"), &Danmaku::get_frames_left);
+    ClassDB::bind_method(D_METHOD("bake_walls"), &Danmaku::bake_walls);
+    ClassDB::bind_method(D_METHOD("get_wall_mask", "position"), &Danmaku::get_wall_mask);
+    ClassDB::bind_method(D_METHOD("get_wall_normal", "position", "mask"), &Danmaku::get_wall_normal);
+    ClassDB::bind_method(D_METHOD("get_pool_report"), &Danmaku::get_pool_report);
+    ClassDB::bind_method(D_METHOD("reset_pool_report"), &Danmaku::reset_pool_report);
+
+    ClassDB::bind_method(D_METHOD("get_monitor", "phase"), &Danmaku::get_monitor);
+    ClassDB::bind_method(D_METHOD("get_monitor_total", "phase"), &Danmaku::get_monitor_total);
+    ClassDB::bind_method(D_METHOD("reset_monitors"), &Danmaku::reset_monitors);
+
+    ClassDB::bind_method(D_METHOD("start_trace", "capacity"), &Danmaku::start_trace, DEFVAL(1 << 18));
+    ClassDB::bind_method(D_METHOD("stop_trace"), &Danmaku::stop_trace);
+    ClassDB::bind_method(D_METHOD("flush_trace", "path"), &Danmaku::flush_trace);
+    ClassDB::bind_method(D_METHOD("is_tracing"), &Danmaku::is_tracing);
+
+    ClassDB::bind_method(D_METHOD("set_effect_profiling", "profiling"), &Danmaku::set_effect_profiling);
+    ClassDB::bind_method(D_METHOD("is_effect_profiling"), &Danmaku::is_effect_profiling);
+    ClassDB::bind_method(D_METHOD("reset_effect_profile"), &Danmaku::reset_effect_profile);
+    ClassDB::bind_method(D_METHOD("get_effect_profile"), &Danmaku::get_effect_profile);
+    ClassDB::bind_method(D_METHOD("get_effect_profile_table"), &Danmaku::get_effect_profile_table);
+    ClassDB::bind_method(D_METHOD("export_effect_profile", "path"), &Danmaku::export_effect_profile);
+
     ClassDB::bind_method(D_METHOD("set_max_shots", "max_shots"), &Danmaku::set_max_shots);
+    ClassDB::bind_method(D_METHOD("set_max_laser_segments", "max_laser_segments"), &Danmaku::set_max_laser_segments);
     ClassDB::bind_method(D_METHOD("set_region", "region"), &Danmaku::set_region);
     ClassDB::bind_method(D_METHOD("set_tolerance", "tolerance"), &Danmaku::set_tolerance);
+    ClassDB::bind_method(D_METHOD("set_static_walls", "static_walls"), &Danmaku::set_static_walls);
+    ClassDB::bind_method(D_METHOD("set_broadphase_cell_size", "broadphase_cell_size"), &Danmaku::set_broadphase_cell_size);
+    ClassDB::bind_method(D_METHOD("set_seed", "seed"), &Danmaku::set_seed);
+    ClassDB::bind_method(D_METHOD("set_wall_cell_size", "wall_cell_size"), &Danmaku::set_wall_cell_size);
     ClassDB::bind_method(D_METHOD("set_atlas", "atlas"), &Danmaku::set_atlas);
+    ClassDB::bind_method(D_METHOD("set_print_pool_report", "print_pool_report"), &Danmaku::set_print_pool_report);
+    ClassDB::bind_method(D_METHOD("set_sfx_cooldowns", "sfx_cooldowns"), &Danmaku::set_sfx_cooldowns);
 
     ClassDB::bind_method(D_METHOD("get_max_shots"), &Danmaku::get_max_shots);
+    ClassDB::bind_method(D_METHOD("get_max_laser_segments"), &Danmaku::get_max_laser_segments);
     ClassDB::bind_method(D_METHOD("get_region"), &Danmaku::get_region);
     ClassDB::bind_method(D_METHOD("get_tolerance"), &Danmaku::get_tolerance);
+    ClassDB::bind_method(D_METHOD("has_static_walls"), &Danmaku::has_static_walls);
+    ClassDB::bind_method(D_METHOD("get_broadphase_cell_size"), &Danmaku::get_broadphase_cell_size);
+    ClassDB::bind_method(D_METHOD("get_seed"), &Danmaku::get_seed);
+    ClassDB::bind_method(D_METHOD("get_wall_cell_size"), &Danmaku::get_wall_cell_size);
     ClassDB::bind_method(D_METHOD("get_atlas"), &Danmaku::get_atlas);
+    ClassDB::bind_method(D_METHOD("get_print_pool_report"), &Danmaku::get_print_pool_report);
+    ClassDB::bind_method(D_METHOD("get_sfx_cooldowns"), &Danmaku::get_sfx_cooldowns);
 
     ClassDB::bind_method(D_METHOD("set_shot_sprite_count", "count"), &Danmaku::set_shot_sprite_count);
     ClassDB::bind_method(D_METHOD("get_shot_sprite_count"), &Danmaku::get_shot_sprite_count);
     ClassDB::bind_method(D_METHOD("set_shot_sprite", "index", "sprite"), &Danmaku::set_shot_sprite);
     ClassDB::bind_method(D_METHOD("get_shot_sprite", "index"), &Danmaku::get_shot_sprite);
 
-    ADD_SIGNAL(MethodInfo("play_sfx", PropertyInfo(Variant::STRING, "key")));
+    ADD_SIGNAL(MethodInfo("play_sfx", PropertyInfo(Variant::STRING, "key"), PropertyInfo(Variant::INT, "count")));
 
     ADD_PROPERTY(PropertyInfo(Variant::INT, "max_shots"), "set_max_shots", "get_max_shots");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "max_laser_segments"), "set_max_laser_segments", "get_max_laser_segments");
     ADD_PROPERTY(PropertyInfo(Variant::RECT2, "region"), "set_region", "get_region");
     ADD_PROPERTY(PropertyInfo(Variant::REAL, "tolerance"), "set_tolerance", "get_tolerance");
+    ADD_PROPERTY(PropertyInfo(Variant::REAL, "broadphase_cell_size", PROPERTY_HINT_RANGE, "8,512,1"), "set_broadphase_cell_size", "get_broadphase_cell_size");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "seed"), "set_seed", "get_seed");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "static_walls"), "set_static_walls", "has_static_walls");
+    ADD_PROPERTY(PropertyInfo(Variant::REAL, "wall_cell_size", PROPERTY_HINT_RANGE, "1,128,1"), "set_wall_cell_size", "get_wall_cell_size");
     ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "atlas", PROPERTY_HINT_RESOURCE_TYPE, "Texture"), "set_atlas", "get_atlas");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "print_pool_report"), "set_print_pool_report", "get_print_pool_report");
+    ADD_PROPERTY(PropertyInfo(Variant::DICTIONARY, "sfx_cooldowns"), "set_sfx_cooldowns", "get_sfx_cooldowns");
 
     ADD_GROUP("Sprites", "shot_");
     ADD_PROPERTY(PropertyInfo(Variant::INT, "shot_sprites", PROPERTY_HINT_EXP_RANGE, "0," + itos(MAX_SHOT_SPRITES) + ",1"), "set_shot_sprite_count", "get_shot_sprite_count");
     for (int i = 0; i != MAX_SHOT_SPRITES; ++i) {
         ADD_PROPERTYI(PropertyInfo(Variant::OBJECT, "shot_sprite_" + itos(i + 1), PROPERTY_HINT_RESOURCE_TYPE, "ShotSprite"), "set_shot_sprite", "get_shot_sprite", i);
     }
+
+    BIND_ENUM_CONSTANT(PHASE_MOVEMENT);
+    BIND_ENUM_CONSTANT(PHASE_EFFECTS);
+    BIND_ENUM_CONSTANT(PHASE_ANIMATION);
+    BIND_ENUM_CONSTANT(PHASE_COLLISION);
+    BIND_ENUM_CONSTANT(PHASE_PHYSICS);
+    BIND_ENUM_CONSTANT(PHASE_COMPACTION);
+    BIND_ENUM_CONSTANT(PHASE_UPDATE_BUFFER);
+    BIND_ENUM_CONSTANT(PHASE_CANCELLATION);
+    BIND_ENUM_CONSTANT(PHASE_MAX);
 }
 
 Danmaku::Danmaku() {
@@ -316,12 +1302,43 @@ Danmaku::Danmaku() {
     _create_material();
     _create_mesh();
     
-    hitbox = NULL;
+    current_tick = 0;
+    seed = 0;
+    ticking = false;
+    advancing = false;
+    print_pool_report = false;
+
+    for (int i = 0; i != PHASE_MAX; ++i) {
+        phase_time[i] = 0;
+        last_phase_time[i] = 0;
+        total_phase_time[i] = 0;
+    }
+    phase_names[PHASE_MOVEMENT] = "movement";
+    phase_names[PHASE_EFFECTS] = "effects";
+    phase_names[PHASE_ANIMATION] = "animation";
+    phase_names[PHASE_COLLISION] = "collision";
+    phase_names[PHASE_PHYSICS] = "physics_queries";
+    phase_names[PHASE_COMPACTION] = "compaction";
+    phase_names[PHASE_UPDATE_BUFFER] = "update_buffer";
+    phase_names[PHASE_CANCELLATION] = "cancellation";
+    trace_active_shots = "active_shots";
+    trace_fire = "fire";
+    trace_spawn = "spawn";
+
     region = Rect2(0, 0, 384, 448);
     tolerance = 64;
+    broadphase_cell_size = 64;
+    shot_grid_dirty = true;
+    static_walls = false;
+    walls_dirty = true;
+    wall_cell_size = 8;
+    walls_width = 0;
+    walls_height = 0;
     max_shots = 0;
+    max_laser_segments = 1024;
     set_shot_sprite_count(1);
     set_max_shots(2048);
+    reset_pool_report();
 }
 
 Danmaku::~Danmaku() {
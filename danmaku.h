@@ -11,19 +11,56 @@
 //        so they can be accessed during gameplay via their key.
 //     3. Defines gameplay region and clear circle -- Patterns will despawn shots that leave
 //        the gameplay region, and clear shots that are inside the clear circle.
-//     4. Keep track of the player's Hitbox.
+//     4. Keep track of the players' Hitboxes, the enemies' Hurtboxes and any Lasers. Each Hitbox
+//        gets a slot that stays the same for as long as it's in the tree, and at the start of
+//        every tick their positions are gathered into one list that every Pattern tests its
+//        shots against.
+//     5. Drive the simulation. Every physics frame Danmaku ticks each of its Patterns in order,
+//        so a whole screen of shots can also be stepped by hand (see DanmakuBenchmark), or
+//        fast forwarded with advance() to seek into a pattern. Advancing also runs the
+//        _physics_process of every unpaused script below the Danmaku once per tick, including
+//        the one advancing, whose nested advance() calls do nothing (see is_advancing()).
+//     6. Run frame timers. Frames nodes and scripts schedule callbacks on a shared timer wheel.
+//     7. Dispatch sound effects. Requests made during a tick are coalesced per key, and each key
+//        is emitted once at the end of the tick along with how many times it was requested.
+//     8. Cancel shots against each other. Patterns whose cancel_mask shares a bit with another
+//        Pattern's cancel_layer clear that Pattern's shots on contact, resolved once per tick
+//        through a grid of every shot that can be cancelled.
+//     9. Answer spatial queries from scripts. The first query after a tick sorts every active shot
+//        into a grid, and the queries of that tick only look at the cells they cover.
+//    10. Bake static walls. With static_walls on, the physics bodies overlapping the region are
+//        sampled once into a grid of collision layer masks, which Patterns look shots up in
+//        instead of querying the physics server per shot.
 // ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
 
 #ifndef DANMAKU_H
 #define DANMAKU_H
 
+#include "core/hash_map.h"
 #include "scene/2d/node_2d.h"
 #include "scene/resources/texture.h"
 
 #include "shot_sprite.h"
 #include "shot.h"
+#include "spatial_grid.h"
+#include "timer_wheel.h"
+#include "tracer.h"
+
+// Per-phase timing, compiled in by default and out entirely when built with kdanmaku_profiling=no
+#ifdef KDANMAKU_PROFILING
+#include "core/os/os.h"
+#define DANMAKU_PROFILE_BEGIN(m_var) uint64_t m_var = OS::get_singleton()->get_ticks_usec()
+#define DANMAKU_PROFILE_END(m_var, m_danmaku, m_phase) (m_danmaku)->add_phase_time(m_phase, m_var, OS::get_singleton()->get_ticks_usec())
+#else
+#define DANMAKU_PROFILE_BEGIN(m_var)
+#define DANMAKU_PROFILE_END(m_var, m_danmaku, m_phase)
+#endif
+
+#define MAX_HITBOXES 32
 
 class Hitbox;
+class Hurtbox;
+class Laser;
 class Pattern;
 
 class Danmaku : public Node2D {
@@ -35,7 +72,50 @@ class Danmaku : public Node2D {
     int max_shots;
     Vector<Shot*> free_shots;
     Vector<Pattern*> patterns;
-    Hitbox* hitbox;
+    Vector<Hitbox*> hitboxes;
+    Vector<Hurtbox*> hurtboxes;
+    Vector<Laser*> lasers;
+    int max_laser_segments;
+    float broadphase_cell_size;
+
+    uint64_t current_tick;
+    uint64_t seed;
+    bool ticking;
+    bool advancing;
+    TimerWheel timers;
+
+    struct SfxRequest {
+        StringName key;
+        int count;
+    };
+    Vector<SfxRequest> sfx_queue;
+    Dictionary sfx_cooldowns;
+    HashMap<StringName, uint64_t> sfx_ready;
+
+    struct {
+        int high_water;
+        int captures;
+        int releases;
+        int denied;
+        int peak_captures;
+        int peak_releases;
+        int peak_demand;
+        uint64_t total_captures;
+        uint64_t total_releases;
+        uint64_t total_denied;
+        uint64_t total_lifetime;
+        uint64_t ticks;
+        Dictionary pattern_peaks;
+    } pool_stats;
+    bool print_pool_report;
+
+    bool static_walls;
+    bool walls_dirty;
+    float wall_cell_size;
+    Rect2 walls_rect;
+    int walls_width;
+    int walls_height;
+    Vector<uint32_t> walls;
 
     Vector<Ref<ShotSprite>> sprites;
     Ref<Texture> atlas;
@@ -52,16 +132,73 @@ protected:
     virtual void _validate_property(PropertyInfo& property) const;
 
 public:
+    enum Phase {
+        PHASE_MOVEMENT,
+        PHASE_EFFECTS,
+        PHASE_ANIMATION,
+        PHASE_COLLISION,
+        PHASE_PHYSICS,
+        PHASE_COMPACTION,
+        PHASE_UPDATE_BUFFER,
+        PHASE_CANCELLATION,
+        PHASE_MAX
+    };
+
     void add_pattern(Pattern* p_pattern);
     void remove_pattern(Pattern* p_pattern);
 
+    // Snapshot of a Hitbox taken at the start of the tick, reach is the larger radius for early outs
+    struct HitboxState {
+        Hitbox* hitbox;
+        Vector2 position;
+        float collision_radius;
+        float graze_radius;
+        float reach;
+        uint32_t layers;
+        uint32_t bit;
+    };
+
     void add_hitbox(Hitbox* p_hitbox);
-    void remove_hitbox();
+    void remove_hitbox(Hitbox* p_hitbox);
     Hitbox* get_hitbox() const;
+    Hitbox* get_hitbox_at(int p_slot) const;
+    int get_hitbox_slot(const Hitbox* p_hitbox) const;
+    int get_hitbox_count() const;
+    Hitbox* get_nearest_hitbox(const Vector2& p_position, uint32_t p_mask) const;
+
+    _FORCE_INLINE_ const Vector<HitboxState>& get_hitbox_states() const { return hitbox_states; }
+
+    struct HurtboxState {
+        Hurtbox* hurtbox;
+        Vector2 position;
+        float radius;
+        uint32_t layers;
+    };
+
+    void add_laser(Laser* p_laser);
+    void remove_laser(Laser* p_laser);
+    int get_laser_count() const;
+
+    void add_hurtbox(Hurtbox* p_hurtbox);
+    void remove_hurtbox(Hurtbox* p_hurtbox);
+    int get_hurtbox_count() const;
+
+    _FORCE_INLINE_ const Vector<HurtboxState>& get_hurtbox_states() const { return hurtbox_states; }
+    _FORCE_INLINE_ const SpatialGrid& get_hurtbox_grid() const { return hurtbox_grid; }
 
     Shot* capture();
+    int capture(int p_count, Vector<Shot*>& r_shots);
     void release(Shot* p_shot);
 
+    // Instance ids are 64 bits wide, so queries return them in an Array rather than a PoolIntArray
+    Array query_circle(const Vector2& p_center, float p_radius);
+    Array query_rect(const Rect2& p_rect);
+    int64_t nearest_shot(const Vector2& p_position, float p_max_distance = 0);
+    Array raycast(const Vector2& p_from, const Vector2& p_to, float p_width = 0);
+
+    // Shots moved or cleared outside of a tick need the query grid rebuilt
+    _FORCE_INLINE_ void invalidate_shot_grid() { shot_grid_dirty = true; }
+
     void clear_all();
     void clear_circle(Vector2 p_origin, float p_radius);
     void clear_rect(Rect2 p_rect);
@@ -73,16 +210,89 @@ public:
     int get_pattern_count() const;
 
     void play_sfx(const StringName& p_key);
+    void set_sfx_cooldown(const StringName& p_key, int p_frames);
+    int get_sfx_cooldown(const StringName& p_key) const;
+
+    void tick();
+    uint64_t get_tick() const;
+
+    void advance(int p_ticks);
+    bool is_advancing() const;
+
+    void bake_walls();
+    _FORCE_INLINE_ uint32_t get_wall_mask(const Vector2& p_position) const {
+        int x = Math::floor((p_position.x - walls_rect.position.x) / wall_cell_size);
+        int y = Math::floor((p_position.y - walls_rect.position.y) / wall_cell_size);
+        if (x < 0 || y < 0 || x >= walls_width || y >= walls_height) {
+            return 0;
+        }
+        return walls[y * walls_width + x];
+    }
+    Vector2 get_wall_normal(const Vector2& p_position, uint32_t p_mask) const;
+
+    int64_t schedule(int p_frames, Object* p_target, const StringName& p_method);
+    void cancel(int64_t p_timer);
+    int get_frames_left(int64_t p_timer) const;
+
+    void record_pattern_peak(Pattern* p_pattern);
+    Dictionary get_pool_report();
+    void reset_pool_report();
+
+    void set_print_pool_report(bool p_print);
+    bool get_print_pool_report() const;
+
+    _FORCE_INLINE_ void add_phase_time(Phase p_phase, uint64_t p_begin, uint64_t p_end) {
+        phase_time[p_phase] += p_end - p_begin;
+        if (tracer.is_active()) {
+            tracer.span(phase_names[p_phase], p_begin, p_end);
+        }
+    }
+    uint64_t get_monitor(Phase p_phase) const;
+    uint64_t get_monitor_total(Phase p_phase) const;
+    void reset_monitors();
+
+    void start_trace(int p_capacity = 1 << 18);
+    void stop_trace();
+    Error flush_trace(const String& p_path);
+    bool is_tracing() const;
+    void set_effect_profiling(bool p_profiling);
+    bool is_effect_profiling() const;
+    void reset_effect_profile();
+    Array get_effect_profile() const;
+    String get_effect_profile_table() const;
+    Error export_effect_profile(const String& p_path) const;
+
+    _FORCE_INLINE_ DanmakuTracer* get_tracer() { return tracer.is_active() ? &tracer : NULL; }
+    _FORCE_INLINE_ const StringName& get_fire_trace_name() const { return trace_fire; }
+    _FORCE_INLINE_ const StringName& get_spawn_trace_name() const { return trace_spawn; }
 
     void set_max_shots(int p_max_shots);
     int get_max_shots() const;
 
+    void set_max_laser_segments(int p_max_laser_segments);
+    int get_max_laser_segments() const;
+
+    void set_sfx_cooldowns(const Dictionary& p_cooldowns);
+    Dictionary get_sfx_cooldowns() const;
+
     void set_region(const Rect2& p_region);
     Rect2 get_region() const;
 
     void set_tolerance(float p_tolerance);
     float get_tolerance() const;
 
+    void set_broadphase_cell_size(float p_size);
+    float get_broadphase_cell_size() const;
+
+    void set_seed(int64_t p_seed);
+    int64_t get_seed() const;
+
+    void set_static_walls(bool p_static_walls);
+    bool has_static_walls() const;
+
+    void set_wall_cell_size(float p_size);
+    float get_wall_cell_size() const;
+
     void set_shot_sprite_count(int p_count);
     int get_shot_sprite_count() const;
 
@@ -99,8 +309,41 @@ public:
     ~Danmaku();
 
 private:
+    uint64_t phase_time[PHASE_MAX];
+    uint64_t last_phase_time[PHASE_MAX];
+    uint64_t total_phase_time[PHASE_MAX];
+    StringName phase_names[PHASE_MAX];
+    StringName trace_active_shots;
+    StringName trace_fire;
+    StringName trace_spawn;
+    DanmakuTracer tracer;
+
+    Vector<HitboxState> hitbox_states;
+    Vector<HurtboxState> hurtbox_states;
+    SpatialGrid hurtbox_grid;
+
+    SpatialGrid cancel_grid;
+    Vector<Shot*> cancel_shots;
+
+    SpatialGrid shot_grid;
+    Vector<Shot*> grid_shots;
+    bool shot_grid_dirty;
+
+    void _allocate_buffer();
     void _create_mesh();
     void _create_material();
+    void _report_profiling();
+    void _print_pool_report();
+    void _propagate_physics_process(Node* p_node);
+    void _update_hitbox_states();
+    void _update_hurtbox_states();
+    void _resolve_cancels();
+    void _update_shot_grid();
+    void _bake_walls();
+    void _emit_sfx(const StringName& p_key, int p_count);
+    void _flush_sfx();
 };
 
+VARIANT_ENUM_CAST(Danmaku::Phase);
+
 #endif
\ No newline at end of file
@@ -1,37 +1,87 @@
 #include "frames.h"
+#include "danmaku.h"
 
 void Frames::_notification(int p_what) {
-    if (p_what == NOTIFICATION_PHYSICS_PROCESS) {
-        if (!stopped) {
-            frames_left--;
-            if (frames_left <= 0) {
-                stop();
-                emit_signal("timeout");
+    switch (p_what) {
+        case NOTIFICATION_ENTER_TREE: {
+            // Timers keep their remaining frames while outside the tree, like a paused physics process would
+            if (!stopped) {
+                _schedule(frames_left);
             }
-        }
+        } break;
+
+        case NOTIFICATION_EXIT_TREE: {
+            _unschedule();
+        } break;
+
+        case NOTIFICATION_PHYSICS_PROCESS: {
+            if (!stopped) {
+                frames_left--;
+                if (frames_left <= 0) {
+                    _timeout();
+                }
+            }
+        } break;
     }
 }
 
 Frames* Frames::start(int p_frames) {
     ERR_FAIL_COND_V(!is_inside_tree(), this);
-    set_physics_process(true);
-    frames_left = p_frames;
+    _unschedule();
     stopped = false;
+    _schedule(p_frames);
     return this;
 }
 
 void Frames::stop() {
+    _unschedule();
     set_physics_process(false);
     frames_left = -1;
     stopped = true;
 }
 
+void Frames::_timeout() {
+    timer = 0;
+    stop();
+    emit_signal("timeout");
+}
+
+void Frames::_schedule(int p_frames) {
+    frames_left = p_frames;
+
+    danmaku = NULL;
+    Node* parent = get_parent();
+    while (parent && !danmaku) {
+        danmaku = Object::cast_to<Danmaku>(parent);
+        parent = parent->get_parent();
+    }
+
+    if (danmaku) {
+        timer = danmaku->schedule(p_frames, this, "_timeout");
+        set_physics_process(false);
+    } else {
+        set_physics_process(true);
+    }
+}
+
+void Frames::_unschedule() {
+    if (danmaku && timer) {
+        frames_left = danmaku->get_frames_left(timer);
+        danmaku->cancel(timer);
+    }
+    danmaku = NULL;
+    timer = 0;
+}
+
 int Frames::get_frames_left() const {
+    if (danmaku && timer) {
+        return danmaku->get_frames_left(timer);
+    }
     return frames_left;
 }
 
 bool Frames::is_stopped() const {
-    return frames_left == -1;
+    return stopped;
 }
 
 void Frames::_bind_methods() {
@@ -39,10 +89,13 @@ void Frames::_bind_methods() {
     ClassDB::bind_method(D_METHOD("stop"), &Frames::stop);
     ClassDB::bind_method(D_METHOD("is_stopped"), &Frames::is_stopped);
     ClassDB::bind_method(D_METHOD("get_frames_left"), &Frames::get_frames_left);
+    ClassDB::bind_method(D_METHOD("_timeout"), &Frames::_timeout);
 
     ADD_SIGNAL(MethodInfo("timeout"));
 }
 
 Frames::Frames() {
+    danmaku = NULL;
+    timer = 0;
     stop();
 }
\ No newline at end of file
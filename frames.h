@@ -3,6 +3,9 @@
 // 
 // Replacement for Godot's built-in Timer object that operates in physics frames instead of seconds,
 // to be consistent with the way time works in the rest of the plugin.
+//
+// Inside a Danmaku, Frames is a thin handle on the Danmaku's timer wheel and costs nothing per
+// frame while it waits. Outside of one, it falls back to counting down in its own physics process.
 // ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
 
 #ifndef FRAMES_H
@@ -10,12 +13,17 @@
 
 #include "scene/main/node.h"
 
+class Danmaku;
+
 class Frames : public Node {
     GDCLASS(Frames, Node);
 
     int frames_left;
     bool stopped;
 
+    Danmaku* danmaku;
+    int64_t timer;
+
 protected:
     void _notification(int p_what);
     static void _bind_methods();
@@ -27,7 +35,13 @@ public:
     void stop();
     bool is_stopped() const;
 
+    void _timeout();
+
     Frames();
+
+private:
+    void _schedule(int p_frames);
+    void _unschedule();
 };
 
 #endif
\ No newline at end of file
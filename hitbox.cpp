@@ -1,4 +1,6 @@
 #include "hitbox.h"
+#include "laser.h"
+#include "pattern.h"
 
 void Hitbox::_notification(int p_what) {
     switch (p_what) {
@@ -16,27 +18,120 @@ void Hitbox::_notification(int p_what) {
 
         case NOTIFICATION_EXIT_TREE: {
             if (danmaku) {
-                danmaku->remove_hitbox();
+                danmaku->remove_hitbox(this);
             }
         } break;
     }
 }
 
 
-void Hitbox::hit(Shot* p_shot) {
+void Hitbox::hit(Shot* p_shot, float p_distance) {
     if (invulnerable) {
         return;
     }
+    _push_event(p_shot->get_instance_id(), p_shot->get_pattern()->get_instance_id(), EVENT_HIT, p_distance);
     colliding_shot = p_shot;
-    emit_signal("hit");
 }
 
-void Hitbox::graze(Shot* p_shot) {
+void Hitbox::graze(Shot* p_shot, float p_distance) {
     if (invulnerable) {
         return;
     }
+    _push_event(p_shot->get_instance_id(), p_shot->get_pattern()->get_instance_id(), EVENT_GRAZE, p_distance);
     grazing_shot = p_shot;
-    emit_signal("graze");
+}
+
+void Hitbox::hit(Laser* p_laser, float p_distance) {
+    if (invulnerable) {
+        return;
+    }
+    _push_event(0, p_laser->get_instance_id(), EVENT_HIT, p_distance);
+}
+
+void Hitbox::graze(Laser* p_laser, float p_distance) {
+    if (invulnerable) {
+        return;
+    }
+    _push_event(0, p_laser->get_instance_id(), EVENT_GRAZE, p_distance);
+}
+
+void Hitbox::_push_event(ObjectID p_shot, ObjectID p_source, EventKind p_kind, float p_distance) {
+    Event event;
+    event.shot = p_shot;
+    event.pattern = p_source;
+    event.kind = p_kind;
+    event.distance = p_distance;
+    events.push_back(event);
+
+    if (p_kind == EVENT_HIT) {
+        tick_hits++;
+    } else {
+        tick_grazes++;
+        graze_count++;
+    }
+}
+
+void Hitbox::clear_events() {
+    events.clear();
+    tick_hits = 0;
+    tick_grazes = 0;
+}
+
+void Hitbox::flush_events() {
+    if (events.empty()) {
+        return;
+    }
+    if (tick_hits) {
+        emit_signal("hit");
+    }
+    if (tick_grazes) {
+        emit_signal("graze");
+    }
+    emit_signal("events_ready");
+}
+
+int Hitbox::get_event_count() const {
+    return events.size();
+}
+
+Dictionary Hitbox::get_events() const {
+    // Instance ids are 64 bits wide, more than a PoolIntArray holds
+    Array shots;
+    Array patterns;
+    PoolIntArray kinds;
+    PoolRealArray distances;
+
+    shots.resize(events.size());
+    patterns.resize(events.size());
+    kinds.resize(events.size());
+    distances.resize(events.size());
+
+    {
+        PoolIntArray::Write kinds_w = kinds.write();
+        PoolRealArray::Write distances_w = distances.write();
+
+        for (int i = 0; i != events.size(); ++i) {
+            shots[i] = (int64_t)events[i].shot;
+            patterns[i] = (int64_t)events[i].pattern;
+            kinds_w[i] = events[i].kind;
+            distances_w[i] = events[i].distance;
+        }
+    }
+
+    Dictionary result;
+    result["shots"] = shots;
+    result["patterns"] = patterns;
+    result["kinds"] = kinds;
+    result["distances"] = distances;
+    return result;
+}
+
+void Hitbox::set_graze_count(int p_count) {
+    graze_count = p_count;
+}
+
+int Hitbox::get_graze_count() const {
+    return graze_count;
 }
 
 Danmaku* Hitbox::get_danmaku() const {
@@ -44,10 +139,14 @@ Danmaku* Hitbox::get_danmaku() const {
 }
 
 void Hitbox::remove_from_danmaku() {
-    danmaku->remove_hitbox();
+    danmaku->remove_hitbox(this);
     danmaku = nullptr;
 }
 
+int Hitbox::get_slot() const {
+    return danmaku ? danmaku->get_hitbox_slot(this) : -1;
+}
+
 Shot* Hitbox::get_colliding_shot() const {
     return colliding_shot;
 }
@@ -64,6 +163,14 @@ bool Hitbox::is_invulnerable() const {
     return invulnerable;
 }
 
+void Hitbox::set_layers(uint32_t p_layers) {
+    layers = p_layers;
+}
+
+uint32_t Hitbox::get_layers() const {
+    return layers;
+}
+
 void Hitbox::set_collision_radius(float p_collision_radius) {
     collision_radius = p_collision_radius;
 }
@@ -82,30 +189,47 @@ float Hitbox::get_graze_radius() const {
 
 void Hitbox::_bind_methods() {
     ClassDB::bind_method(D_METHOD("get_danmaku"), &Hitbox::get_danmaku);
+    ClassDB::bind_method(D_METHOD("get_slot"), &Hitbox::get_slot);
     ClassDB::bind_method(D_METHOD("get_colliding_shot"), &Hitbox::get_colliding_shot);
     ClassDB::bind_method(D_METHOD("get_grazing_shot"), &Hitbox::get_grazing_shot);
+    ClassDB::bind_method(D_METHOD("get_event_count"), &Hitbox::get_event_count);
+    ClassDB::bind_method(D_METHOD("get_events"), &Hitbox::get_events);
 
     ClassDB::bind_method(D_METHOD("set_invulnerable", "invulnerable"), &Hitbox::set_invulnerable);
+    ClassDB::bind_method(D_METHOD("set_layers", "layers"), &Hitbox::set_layers);
     ClassDB::bind_method(D_METHOD("set_collision_radius", "collision_radius"), &Hitbox::set_collision_radius);
     ClassDB::bind_method(D_METHOD("set_graze_radius", "graze_radius"), &Hitbox::set_graze_radius);
+    ClassDB::bind_method(D_METHOD("set_graze_count", "graze_count"), &Hitbox::set_graze_count);
 
     ClassDB::bind_method(D_METHOD("is_invulnerable"), &Hitbox::is_invulnerable);
+    ClassDB::bind_method(D_METHOD("get_layers"), &Hitbox::get_layers);
     ClassDB::bind_method(D_METHOD("get_collision_radius"), &Hitbox::get_collision_radius);
     ClassDB::bind_method(D_METHOD("get_graze_radius"), &Hitbox::get_graze_radius);
+    ClassDB::bind_method(D_METHOD("get_graze_count"), &Hitbox::get_graze_count);
 
     ADD_PROPERTY(PropertyInfo(Variant::BOOL, "invulnerable"), "set_invulnerable", "is_invulnerable");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "layers", PROPERTY_HINT_LAYERS_2D_PHYSICS), "set_layers", "get_layers");
     ADD_PROPERTY(PropertyInfo(Variant::REAL, "collision_radius"), "set_collision_radius", "get_collision_radius");
     ADD_PROPERTY(PropertyInfo(Variant::REAL, "graze_radius"), "set_graze_radius", "get_graze_radius");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "graze_count", PROPERTY_HINT_NONE, "", 0), "set_graze_count", "get_graze_count");
 
     ADD_SIGNAL(MethodInfo("hit"));
     ADD_SIGNAL(MethodInfo("graze"));
+    ADD_SIGNAL(MethodInfo("events_ready"));
+
+    BIND_ENUM_CONSTANT(EVENT_HIT);
+    BIND_ENUM_CONSTANT(EVENT_GRAZE);
 }
 
 Hitbox::Hitbox() {
     collision_radius = 2;
     graze_radius = 16;
     invulnerable = false;
+    layers = 1;
     colliding_shot = NULL;
     grazing_shot = NULL;
     danmaku = NULL;
+    tick_hits = 0;
+    tick_grazes = 0;
+    graze_count = 0;
 }
\ No newline at end of file
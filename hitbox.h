@@ -3,6 +3,10 @@
 // 
 // Hitbox for the player. Has both a collision radius and a graze radius.
 // This object doesn't really do much itself -- the collisions are handled by Patterns.
+// A Danmaku can hold several Hitboxes, and only Patterns whose hitbox_mask shares a bit with a
+// Hitbox's layers collide with it.
+// Hits and grazes, by shots or lasers, are collected into a per-tick event buffer, and the signals are emitted
+// once at the end of each tick rather than once per shot.
 // ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
 
 #ifndef HITBOX_H
@@ -13,31 +17,67 @@
 #include "danmaku.h"
 #include "shot.h"
 
+class Laser;
+
 class Hitbox : public Node2D {
     GDCLASS(Hitbox, Node2D);
 
+    struct Event {
+        ObjectID shot;
+        ObjectID pattern;
+        int kind;
+        float distance;
+    };
+
     float collision_radius;
     float graze_radius;
     bool invulnerable;
+    uint32_t layers;
 
     Danmaku* danmaku;
     Shot* grazing_shot;
     Shot* colliding_shot;
 
+    Vector<Event> events;
+    int tick_hits;
+    int tick_grazes;
+    uint64_t graze_count;
+
 protected:
     static void _bind_methods();
     void _notification(int p_what);
 
 public:
-    void hit(Shot* p_shot);
-    void graze(Shot* p_shot);
+    enum EventKind {
+        EVENT_HIT,
+        EVENT_GRAZE
+    };
+
+    void hit(Shot* p_shot, float p_distance);
+    void graze(Shot* p_shot, float p_distance);
+
+    // Laser events have no shot, and the laser in place of the pattern
+    void hit(Laser* p_laser, float p_distance);
+    void graze(Laser* p_laser, float p_distance);
+
+    void clear_events();
+    void flush_events();
+    int get_event_count() const;
+    Dictionary get_events() const;
+
+    void set_graze_count(int p_count);
+    int get_graze_count() const;
 
     Danmaku* get_danmaku() const;
     void remove_from_danmaku();
+    int get_slot() const;
 
     void set_invulnerable(bool p_invulnerable);
     bool is_invulnerable() const;
 
+    void set_layers(uint32_t p_layers);
+    uint32_t get_layers() const;
+
     Shot* get_colliding_shot() const;
     Shot* get_grazing_shot() const;
 
@@ -48,6 +88,11 @@ public:
     float get_graze_radius() const;
 
     Hitbox();
+
+private:
+    void _push_event(ObjectID p_shot, ObjectID p_source, EventKind p_kind, float p_distance);
 };
 
+VARIANT_ENUM_CAST(Hitbox::EventKind);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include "hurtbox.h"
+
+void Hurtbox::_notification(int p_what) {
+    switch (p_what) {
+        case NOTIFICATION_ENTER_TREE: {
+            Node* parent = this;
+            while (parent) {
+                danmaku = Object::cast_to<Danmaku>(parent);
+                if (danmaku) {
+                    danmaku->add_hurtbox(this);
+                    break;
+                }
+                parent = parent->get_parent();
+            }
+        } break;
+
+        case NOTIFICATION_EXIT_TREE: {
+            if (danmaku) {
+                danmaku->remove_hurtbox(this);
+            }
+        } break;
+    }
+}
+
+void Hurtbox::hurt(Shot* p_shot, float p_damage) {
+    if (invulnerable) {
+        return;
+    }
+    tick_damage += p_damage;
+    total_damage += p_damage;
+    tick_hits++;
+}
+
+void Hurtbox::clear_events() {
+    tick_damage = 0;
+    tick_hits = 0;
+}
+
+void Hurtbox::flush_events() {
+    if (!tick_hits) {
+        return;
+    }
+    emit_signal("damaged", tick_damage, tick_hits);
+}
+
+float Hurtbox::get_tick_damage() const {
+    return tick_damage;
+}
+
+int Hurtbox::get_tick_hits() const {
+    return tick_hits;
+}
+
+void Hurtbox::set_total_damage(float p_damage) {
+    total_damage = p_damage;
+}
+
+float Hurtbox::get_total_damage() const {
+    return total_damage;
+}
+
+Danmaku* Hurtbox::get_danmaku() const {
+    return danmaku;
+}
+
+void Hurtbox::remove_from_danmaku() {
+    danmaku->remove_hurtbox(this);
+    danmaku = nullptr;
+}
+
+void Hurtbox::set_radius(float p_radius) {
+    radius = p_radius;
+}
+
+float Hurtbox::get_radius() const {
+    return radius;
+}
+
+void Hurtbox::set_layers(uint32_t p_layers) {
+    layers = p_layers;
+}
+
+uint32_t Hurtbox::get_layers() const {
+    return layers;
+}
+
+void Hurtbox::set_invulnerable(bool p_invulnerable) {
+    invulnerable = p_invulnerable;
+}
+
+bool Hurtbox::is_invulnerable() const {
+    return invulnerable;
+}
+
+void Hurtbox::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("get_danmaku"), &Hurtbox::get_danmaku);
+    ClassDB::bind_method(D_METHOD("get_tick_damage"), &Hurtbox::get_tick_damage);
+    ClassDB::bind_method(D_METHOD("get_tick_hits"), &Hurtbox::get_tick_hits);
+
+    ClassDB::bind_method(D_METHOD("set_radius", "radius"), &Hurtbox::set_radius);
+    ClassDB::bind_method(D_METHOD("set_layers", "layers"), &Hurtbox::set_layers);
+    ClassDB::bind_method(D_METHOD("set_invulnerable", "invulnerable"), &Hurtbox::set_invulnerable);
+    ClassDB::bind_method(D_METHOD("set_total_damage", "total_damage"), &Hurtbox::set_total_damage);
+
+    ClassDB::bind_method(D_METHOD("get_radius"), &Hurtbox::get_radius);
+    ClassDB::bind_method(D_METHOD("get_layers"), &Hurtbox::get_layers);
+    ClassDB::bind_method(D_METHOD("is_invulnerable"), &Hurtbox::is_invulnerable);
+    ClassDB::bind_method(D_METHOD("get_total_damage"), &Hurtbox::get_total_damage);
+
+    ADD_PROPERTY(PropertyInfo(Variant::REAL, "radius"), "set_radius", "get_radius");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "layers", PROPERTY_HINT_LAYERS_2D_PHYSICS), "set_layers", "get_layers");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "invulnerable"), "set_invulnerable", "is_invulnerable");
+    ADD_PROPERTY(PropertyInfo(Variant::REAL, "total_damage", PROPERTY_HINT_NONE, "", 0), "set_total_damage", "get_total_damage");
+
+    ADD_SIGNAL(MethodInfo("damaged", PropertyInfo(Variant::REAL, "damage"), PropertyInfo(Variant::INT, "hits")));
+}
+
+Hurtbox::Hurtbox() {
+    radius = 16;
+    layers = 1;
+    invulnerable = false;
+    danmaku = NULL;
+    tick_damage = 0;
+    tick_hits = 0;
+    total_damage = 0;
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+// ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
+// *:･ﾟ✧ hurtbox.hpp *:･ﾟ✧
+// 
+// Hurtbox for enemies, the target of the player's own shots. Patterns with a hurtbox_mask collide
+// their shots against every Hurtbox on those layers, through a grid Danmaku builds once per tick.
+// Damage taken over a tick is summed up, and the Hurtbox emits one damaged signal at its end.
+// ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
+
+#ifndef HURTBOX_H
+#define HURTBOX_H
+
+#include "scene/2d/node_2d.h"
+
+#include "danmaku.h"
+#include "shot.h"
+
+class Hurtbox : public Node2D {
+    GDCLASS(Hurtbox, Node2D);
+
+    float radius;
+    uint32_t layers;
+    bool invulnerable;
+
+    Danmaku* danmaku;
+
+    float tick_damage;
+    int tick_hits;
+    float total_damage;
+
+protected:
+    static void _bind_methods();
+    void _notification(int p_what);
+
+public:
+    void hurt(Shot* p_shot, float p_damage);
+
+    void clear_events();
+    void flush_events();
+
+    float get_tick_damage() const;
+    int get_tick_hits() const;
+
+    void set_total_damage(float p_damage);
+    float get_total_damage() const;
+
+    Danmaku* get_danmaku() const;
+    void remove_from_danmaku();
+
+    void set_radius(float p_radius);
+    float get_radius() const;
+
+    void set_layers(uint32_t p_layers);
+    uint32_t get_layers() const;
+
+    void set_invulnerable(bool p_invulnerable);
+    bool is_invulnerable() const;
+
+    Hurtbox();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,303 @@
+#include "laser.h"
+#include "hitbox.h"
+
+#include "core/math/math_funcs.h"
+
+void Laser::_notification(int p_what) {
+    switch (p_what) {
+        case NOTIFICATION_ENTER_TREE: {
+            Node* parent = this;
+            while (parent) {
+                danmaku = Object::cast_to<Danmaku>(parent);
+                if (danmaku) {
+                    danmaku->add_laser(this);
+                    break;
+                }
+                parent = parent->get_parent();
+            }
+        } break;
+
+        case NOTIFICATION_EXIT_TREE: {
+            if (danmaku) {
+                danmaku->remove_laser(this);
+            }
+            clear();
+        } break;
+    }
+}
+
+void Laser::fire() {
+    ERR_FAIL_NULL(danmaku);
+    sprite = danmaku->get_sprite(sprite_key);
+    ERR_FAIL_COND_MSG(sprite.is_null(), "No sprite defined, cannot fire");
+
+    clear();
+    frame = sprite->get_frame(0);
+    head_position = get_global_position();
+    head_rotation = get_global_rotation();
+    firing = true;
+    _push_point(head_position);
+}
+
+void Laser::stop() {
+    firing = false;
+}
+
+void Laser::clear() {
+    firing = false;
+    head = 0;
+    count = 0;
+    colliding_hitboxes = 0;
+    grazing_hitboxes = 0;
+}
+
+bool Laser::is_active() const {
+    return count != 0;
+}
+
+bool Laser::is_firing() const {
+    return firing;
+}
+
+int Laser::get_point_count() const {
+    return count;
+}
+
+Vector2 Laser::get_point(int p_index) const {
+    ERR_FAIL_INDEX_V(p_index, count, Vector2());
+    return _point(p_index);
+}
+
+void Laser::_push_point(const Vector2& p_point) {
+    points.write[head] = p_point;
+    head = (head + 1) % points.size();
+    count = MIN(count + 1, points.size());
+}
+
+void Laser::_tick() {
+    if (!count) {
+        return;
+    }
+
+    Rect2 region = danmaku->get_region().grow(danmaku->get_tolerance());
+
+    // The head stops once it leaves the region or the laser is stopped, then the tail catches up to it
+    if (firing && region.has_point(head_position)) {
+        head_rotation += angular_velocity;
+        head_position += Vector2(Math::cos(head_rotation), Math::sin(head_rotation)) * speed;
+        _push_point(head_position);
+    } else {
+        firing = false;
+        count--;
+        if (!count) {
+            return;
+        }
+    }
+
+    if (--frame.delay <= 0) {
+        frame = sprite->get_frame(frame.next);
+    }
+
+    float radius = width / 2;
+    bounds = Rect2(_point(0), Vector2());
+    for (int i = 1; i != count; ++i) {
+        bounds.expand_to(_point(i));
+    }
+    bounds = bounds.grow(radius);
+
+    DANMAKU_PROFILE_BEGIN(collision_begin);
+    _collide();
+    DANMAKU_PROFILE_END(collision_begin, danmaku, Danmaku::PHASE_COLLISION);
+}
+
+void Laser::_collide() {
+    const Vector<Danmaku::HitboxState>& hitboxes = danmaku->get_hitbox_states();
+    float radius = width / 2;
+
+    for (int i = 0; i != hitboxes.size(); ++i) {
+        const Danmaku::HitboxState& state = hitboxes[i];
+        if (!(state.layers & hitbox_mask)) {
+            continue;
+        }
+
+        float graze_reach = state.graze_radius + radius;
+        float collision_reach = state.collision_radius + radius;
+        float reach = MAX(graze_reach, collision_reach);
+
+        // Only walk the segments when the hitbox is anywhere near the laser
+        float distance_squared = 1e20;
+        if (bounds.grow(reach - radius).has_point(state.position)) {
+            for (int j = 0; j + 1 < count; ++j) {
+                Vector2 a = _point(j);
+                Vector2 segment = _point(j + 1) - a;
+                float length_squared = segment.length_squared();
+                float t = length_squared > 0 ? CLAMP((state.position - a).dot(segment) / length_squared, 0, 1) : 0;
+                distance_squared = MIN(distance_squared, (a + segment * t).distance_squared_to(state.position));
+            }
+            if (count == 1) {
+                distance_squared = _point(0).distance_squared_to(state.position);
+            }
+        }
+
+        if (distance_squared <= collision_reach * collision_reach) {
+            if (!(colliding_hitboxes & state.bit)) {
+                state.hitbox->hit(this, Math::sqrt(distance_squared));
+                colliding_hitboxes |= state.bit;
+            }
+        } else {
+            colliding_hitboxes &= ~state.bit;
+        }
+
+        if (distance_squared <= graze_reach * graze_reach) {
+            if (!(grazing_hitboxes & state.bit)) {
+                state.hitbox->graze(this, Math::sqrt(distance_squared));
+                grazing_hitboxes |= state.bit;
+            }
+        } else {
+            grazing_hitboxes &= ~state.bit;
+        }
+    }
+}
+
+int Laser::fill_buffer(real_t*& buf, int p_capacity) {
+    ERR_FAIL_NULL_V(danmaku, 0);
+    if (count < 2 || sprite.is_null()) {
+        return 0;
+    }
+
+    Ref<Texture> atlas = danmaku->get_atlas();
+    if (!atlas.is_valid()) {
+        return 0;
+    }
+    Size2 atlas_size = atlas->get_size();
+    Transform2D transform = danmaku->get_global_transform().affine_inverse();
+
+    Rect2 region = frame.region;
+    int segments = MIN(count - 1, p_capacity);
+    for (int i = 0; i != segments; ++i) {
+        Vector2 a = transform.xform(_point(i));
+        Vector2 b = transform.xform(_point(i + 1));
+
+        // Stretch the sprite's x axis over the segment, and its y axis over the laser's width
+        Vector2 x = (b - a) / 2;
+        Vector2 y = x.normalized().tangent() * (width / 2);
+        Vector2 position = (a + b) / 2;
+
+        buf[0] = x.x;
+        buf[1] = y.x;
+        buf[2] = 0;
+        buf[3] = position.x;
+        buf[4] = x.y;
+        buf[5] = y.y;
+        buf[6] = 0;
+        buf[7] = position.y;
+
+        buf[8] = region.size.width / atlas_size.width;
+        buf[9] = region.size.height / atlas_size.height;
+        buf[10] = region.position.x / atlas_size.width;
+        buf[11] = region.position.y / atlas_size.height;
+
+        buf += (8 + 4);
+    }
+
+    return segments;
+}
+
+Danmaku* Laser::get_danmaku() const {
+    return danmaku;
+}
+
+void Laser::remove_from_danmaku() {
+    ERR_FAIL_NULL(danmaku);
+    danmaku->remove_laser(this);
+    danmaku = nullptr;
+    clear();
+}
+
+void Laser::set_sprite(const String& p_key) {
+    sprite_key = p_key;
+}
+String Laser::get_sprite() const {
+    return sprite_key;
+}
+
+void Laser::set_width(float p_width) {
+    width = p_width;
+}
+float Laser::get_width() const {
+    return width;
+}
+
+void Laser::set_speed(float p_speed) {
+    speed = p_speed;
+}
+float Laser::get_speed() const {
+    return speed;
+}
+
+void Laser::set_angular_velocity(float p_angular_velocity) {
+    angular_velocity = p_angular_velocity;
+}
+float Laser::get_angular_velocity() const {
+    return angular_velocity;
+}
+
+void Laser::set_max_points(int p_max_points) {
+    ERR_FAIL_COND(p_max_points < 2);
+    max_points = p_max_points;
+    points.resize(max_points);
+    clear();
+}
+int Laser::get_max_points() const {
+    return max_points;
+}
+
+void Laser::set_hitbox_mask(uint32_t p_hitbox_mask) {
+    hitbox_mask = p_hitbox_mask;
+}
+uint32_t Laser::get_hitbox_mask() const {
+    return hitbox_mask;
+}
+
+void Laser::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("fire"), &Laser::fire);
+    ClassDB::bind_method(D_METHOD("stop"), &Laser::stop);
+    ClassDB::bind_method(D_METHOD("clear"), &Laser::clear);
+
+    ClassDB::bind_method(D_METHOD("is_active"), &Laser::is_active);
+    ClassDB::bind_method(D_METHOD("is_firing"), &Laser::is_firing);
+    ClassDB::bind_method(D_METHOD("get_point_count"), &Laser::get_point_count);
+    ClassDB::bind_method(D_METHOD("get_point", "index"), &Laser::get_point);
+    ClassDB::bind_method(D_METHOD("get_danmaku"), &Laser::get_danmaku);
+
+    ClassDB::bind_method(D_METHOD("set_sprite", "sprite"), &Laser::set_sprite);
+    ClassDB::bind_method(D_METHOD("set_width", "width"), &Laser::set_width);
+    ClassDB::bind_method(D_METHOD("set_speed", "speed"), &Laser::set_speed);
+    ClassDB::bind_method(D_METHOD("set_angular_velocity", "angular_velocity"), &Laser::set_angular_velocity);
+    ClassDB::bind_method(D_METHOD("set_max_points", "max_points"), &Laser::set_max_points);
+    ClassDB::bind_method(D_METHOD("set_hitbox_mask", "hitbox_mask"), &Laser::set_hitbox_mask);
+
+    ClassDB::bind_method(D_METHOD("get_sprite"), &Laser::get_sprite);
+    ClassDB::bind_method(D_METHOD("get_width"), &Laser::get_width);
+    ClassDB::bind_method(D_METHOD("get_speed"), &Laser::get_speed);
+    ClassDB::bind_method(D_METHOD("get_angular_velocity"), &Laser::get_angular_velocity);
+    ClassDB::bind_method(D_METHOD("get_max_points"), &Laser::get_max_points);
+    ClassDB::bind_method(D_METHOD("get_hitbox_mask"), &Laser::get_hitbox_mask);
+
+    ADD_PROPERTY(PropertyInfo(Variant::STRING, "sprite"), "set_sprite", "get_sprite");
+    ADD_PROPERTY(PropertyInfo(Variant::REAL, "width"), "set_width", "get_width");
+    ADD_PROPERTY(PropertyInfo(Variant::REAL, "speed"), "set_speed", "get_speed");
+    ADD_PROPERTY(PropertyInfo(Variant::REAL, "angular_velocity"), "set_angular_velocity", "get_angular_velocity");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "max_points", PROPERTY_HINT_RANGE, "2,1024,1"), "set_max_points", "get_max_points");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "hitbox_mask", PROPERTY_HINT_LAYERS_2D_PHYSICS), "set_hitbox_mask", "get_hitbox_mask");
+}
+
+Laser::Laser() {
+    danmaku = NULL;
+    width = 8;
+    speed = 8;
+    angular_velocity = 0;
+    hitbox_mask = 1;
+    head_rotation = 0;
+    set_max_points(32);
+}
\ No newline at end of file
@@ -0,0 +1,103 @@
+// ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
+// *:･ﾟ✧ laser.hpp *:･ﾟ✧
+// 
+// Laser is a single beam that would otherwise take dozens of overlapping Shots to build.
+// Once fired, its head travels from where the Laser was, by speed along its rotation, turning by
+// angular_velocity every tick. The head's positions are kept in a ring buffer, so a straight laser
+// is one that never turns and a curved one just does. The buffer holds max_points positions and
+// the oldest drop off the tail.
+//
+// Every pair of neighbouring points is one segment. Segments are drawn as stretched sprites in
+// Danmaku's multimesh, and collide with Hitboxes as capsules after a bounding box early out.
+// ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
+
+#ifndef LASER_H
+#define LASER_H
+
+#include "scene/2d/node_2d.h"
+
+#include "danmaku.h"
+#include "shot_sprite.h"
+
+class Laser : public Node2D {
+    GDCLASS(Laser, Node2D);
+
+    Danmaku* danmaku;
+
+    String sprite_key;
+    Ref<ShotSprite> sprite;
+    ShotFrame frame;
+
+    float width;
+    float speed;
+    float angular_velocity;
+    int max_points;
+    uint32_t hitbox_mask;
+
+    Vector<Vector2> points;
+    int head;
+    int count;
+    Vector2 head_position;
+    float head_rotation;
+    bool firing;
+    Rect2 bounds;
+
+    uint32_t colliding_hitboxes;
+    uint32_t grazing_hitboxes;
+
+protected:
+    void _notification(int p_what);
+    static void _bind_methods();
+
+public:
+    void fire();
+    void stop();
+    void clear();
+
+    bool is_active() const;
+    bool is_firing() const;
+    int get_point_count() const;
+    Vector2 get_point(int p_index) const;
+
+    Danmaku* get_danmaku() const;
+    void remove_from_danmaku();
+
+    // A hitbox slot that's been freed shouldn't leave the next hitbox in it already touching the beam
+    _FORCE_INLINE_ void forget_hitbox(uint32_t p_bit) {
+        colliding_hitboxes &= ~p_bit;
+        grazing_hitboxes &= ~p_bit;
+    }
+
+    void set_sprite(const String& p_key);
+    String get_sprite() const;
+
+    void set_width(float p_width);
+    float get_width() const;
+
+    void set_speed(float p_speed);
+    float get_speed() const;
+
+    void set_angular_velocity(float p_angular_velocity);
+    float get_angular_velocity() const;
+
+    void set_max_points(int p_max_points);
+    int get_max_points() const;
+
+    void set_hitbox_mask(uint32_t p_hitbox_mask);
+    uint32_t get_hitbox_mask() const;
+
+    int fill_buffer(real_t*& buf, int p_capacity);
+
+    void _tick();
+
+    Laser();
+
+private:
+    _FORCE_INLINE_ const Vector2& _point(int p_index) const {
+        return points[(head - count + p_index + points.size()) % points.size()];
+    }
+    void _push_point(const Vector2& p_point);
+    void _collide();
+};
+
+#endif
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "pattern.h"
 #include "hitbox.h"
+#include "hurtbox.h"
+#include "counter_rng.h"
 
 #include "core/math/math_funcs.h"
 #include "servers/physics_2d_server.h"
@@ -11,12 +13,25 @@ void Pattern::_notification(int p_what) {
             while (parent) {
                 danmaku = Object::cast_to<Danmaku>(parent);
                 if (danmaku) {
+                    motion_tick = danmaku->get_tick();
+                    volley = 0;
+                    update_seed_key();
                     danmaku->add_pattern(this);
                     break;
                 }
                 parent = parent->get_parent();
             }
-            set_physics_process(true);
+        } break;
+
+        case NOTIFICATION_TRANSFORM_CHANGED: {
+            // Every shot moves along with the pattern, including ones sitting still
+            if (danmaku) {
+                for (int i = 0; i != shots.size(); ++i) {
+                    shots[i]->flag(Shot::FLAG_UPDATE_GLOBAL);
+                }
+                invalidate_expire_ticks();
+                danmaku->invalidate_shot_grid();
+            }
         } break;
 
         case NOTIFICATION_EXIT_TREE: {
@@ -25,13 +40,18 @@ void Pattern::_notification(int p_what) {
                     danmaku->release(shots[i]);
                 }
                 shots.resize(0);
+                spawn_queue.clear();
                 danmaku->remove_pattern(this);
             }
         } break;
+    }
+}
 
-        case NOTIFICATION_PHYSICS_PROCESS: {
-            _tick();
-        } break;
+void Pattern::invalidate_expire_ticks() {
+    for (int i = 0; i != shots.size(); ++i) {
+        if (shots[i]->flagged(Shot::FLAG_LINEAR)) {
+            shots[i]->invalidate_expire_tick();
+        }
     }
 }
 
@@ -43,94 +63,256 @@ void Pattern::_tick() {
         return;
     }
 
+    DANMAKU_PROFILE_BEGIN(tick_begin);
+
     bool clean = false;
     Rect2 region = danmaku->get_region().grow(despawn_distance + danmaku->get_tolerance());
-    Hitbox* hitbox = danmaku->get_hitbox();
 
-    Vector2 hitbox_position = Vector2(0, 0);
-    if (hitbox) {
-        hitbox_position = hitbox->get_global_transform().get_origin();
+    // Only the hitboxes on this pattern's layers take part in collision
+    const Vector<Danmaku::HitboxState>& all_hitboxes = danmaku->get_hitbox_states();
+    Danmaku::HitboxState hitboxes[MAX_HITBOXES];
+    int hitbox_count = 0;
+    for (int i = 0; i != all_hitboxes.size(); ++i) {
+        if (all_hitboxes[i].layers & hitbox_mask) {
+            hitboxes[hitbox_count++] = all_hitboxes[i];
+        }
     }
 
-    // Update all shots
-    for (int i = 0; i != shots.size(); ++i) {
-        Shot* shot = shots[i];
+    // Shots fired during the tick (e.g. by effects) start simulating next tick, same as shots fired from scripts
+    int count = shots.size();
 
-        if (!shot->flagged(Shot::FLAG_ACTIVE)) {
-            clean = true;
+    // Homing shots steer towards the nearest hitbox, worked out in this pattern's own space
+    Transform2D inverse = get_global_transform().affine_inverse();
+    Vector2 targets[MAX_HITBOXES];
+    for (int i = 0; i != hitbox_count; ++i) {
+        targets[i] = inverse.xform(hitboxes[i].position);
+    }
+
+    // Move shots by their direction and speed, accelerating and turning them first if they do.
+    // Shots without effects moving in a straight line are switched over to being evaluated from their
+    // origin instead, and aren't touched here again until something changes their motion.
+    DANMAKU_PROFILE_BEGIN(movement_begin);
+    uint64_t tick = danmaku->get_tick();
+    Transform2D transform = get_global_transform();
+    for (int i = 0; i != count; ++i) {
+        Shot* shot = shots[i];
+        if (!shot->flagged(Shot::FLAG_ACTIVE) || shot->flagged(Shot::FLAG_PAUSED | Shot::FLAG_LINEAR)) {
             continue;
         }
 
-        if (!shot->flagged(Shot::FLAG_PAUSED)) {
-            // Move shot by its direction and speed, then update its global position
-            shot->set_position(shot->get_position() + shot->get_velocity());
+        if (shot->can_linearize()) {
+            shot->linearize(tick - 1, transform, region);
+            continue;
+        }
 
-            // Run effect
-            if (!shot->flagged(Shot::FLAG_CLEARED)) {
-                if (shot->get_effect().is_valid()) {
-                    shot->get_effect()->execute(shot);
+        if (shot->flagged(Shot::FLAG_KINEMATIC)) {
+            const Vector2* target = NULL;
+            if (shot->get_homing() > 0) {
+                float nearest = 0;
+                for (int j = 0; j != hitbox_count; ++j) {
+                    float distance = targets[j].distance_squared_to(shot->get_position());
+                    if (!target || distance < nearest) {
+                        target = &targets[j];
+                        nearest = distance;
+                    }
                 }
             }
+            shot->integrate(target);
+        }
+        shot->set_position(shot->get_position() + shot->get_velocity());
+    }
+    motion_tick = tick;
+    DANMAKU_PROFILE_END(movement_begin, danmaku, Danmaku::PHASE_MOVEMENT);
+
+    // Run effects, skipping shots whose effects are all asleep on timers
+    DANMAKU_PROFILE_BEGIN(effects_begin);
+    for (int i = 0; i != count; ++i) {
+        Shot* shot = shots[i];
+        if (shot->get_wake_tick() > tick) {
+            continue;
+        }
+        if (shot->flagged(Shot::FLAG_ACTIVE) && !shot->flagged(Shot::FLAG_PAUSED | Shot::FLAG_CLEARED)) {
+            if (shot->get_effect().is_valid()) {
+                shot->get_effect()->execute(shot);
+            }
+        }
+    }
+    DANMAKU_PROFILE_END(effects_begin, danmaku, Danmaku::PHASE_EFFECTS);
+
+    // Process animations, and clear shots that are outside the gameplay region
+    DANMAKU_PROFILE_BEGIN(animation_begin);
+    for (int i = 0; i != count; ++i) {
+        Shot* shot = shots[i];
+
+        if (!shot->flagged(Shot::FLAG_ACTIVE)) {
+            clean = true;
+            continue;
         }
 
-        // Process animations
         ShotFrame* frame = shot->get_frame();
         if (--frame->delay <= 0) {
             if (frame->cleared) {
                 shot->unflag(Shot::FLAG_ACTIVE);
                 clean = true;
+                continue;
             } else {
                 *frame = shot->get_sprite()->get_frame(frame->next);
             }
         }
 
-        // Check for graze or collision
-        if (hitbox != NULL) {
-            float distance = shot->get_global_position().distance_to(hitbox_position);
+        // Linear shots were solved for when they leave the region, check them then in case the pattern moved
+        if (shot->flagged(Shot::FLAG_LINEAR) && tick < shot->get_expire_tick()) {
+            continue;
+        }
+        if (!region.has_point(shot->get_global_position())) {
+            _handle(shot, ShotEffect::EVENT_DESPAWN, Variant());
+            shot->unflag(Shot::FLAG_ACTIVE);
+            clean = true;
+        } else if (shot->flagged(Shot::FLAG_LINEAR)) {
+            shot->update_expire_tick(tick, transform, region);
+        }
+    }
+    DANMAKU_PROFILE_END(animation_begin, danmaku, Danmaku::PHASE_ANIMATION);
+
+    // Check for graze or collision against every hitbox at once
+    if (hitbox_count) {
+        DANMAKU_PROFILE_BEGIN(collision_begin);
+        for (int i = 0; i != count; ++i) {
+            Shot* shot = shots[i];
+            if (!shot->flagged(Shot::FLAG_ACTIVE)) {
+                continue;
+            }
 
-            if (distance <= hitbox->get_collision_radius() + shot->get_radius()) {
-                if (!shot->flagged(Shot::FLAG_COLLIDING)) {
-                    hitbox->hit(shot);
-                    shot->flag(Shot::FLAG_COLLIDING);
+            Vector2 position = shot->get_global_position();
+            float radius = shot->get_radius();
+            uint32_t colliding = shot->get_colliding_hitboxes();
+            uint32_t grazing = shot->get_grazing_hitboxes();
+
+            for (int j = 0; j != hitbox_count; ++j) {
+                const Danmaku::HitboxState& state = hitboxes[j];
+
+                // Most shots are nowhere near any given player, so test against its bounds first
+                Vector2 offset = position - state.position;
+                float extent = state.reach + radius;
+                if (Math::abs(offset.x) > extent || Math::abs(offset.y) > extent) {
+                    colliding &= ~state.bit;
+                    grazing &= ~state.bit;
+                    continue;
+                }
+                float distance_squared = offset.length_squared();
+
+                float collision_reach = state.collision_radius + radius;
+                if (distance_squared <= collision_reach * collision_reach) {
+                    if (!(colliding & state.bit)) {
+                        state.hitbox->hit(shot, Math::sqrt(distance_squared));
+                        _handle(shot, ShotEffect::EVENT_HIT, state.hitbox->get_slot());
+                        colliding |= state.bit;
+                    }
+                } else {
+                    colliding &= ~state.bit;
                 }
-            } else {
-                shot->unflag(Shot::FLAG_COLLIDING);
-            }
 
-            if (distance <= hitbox->get_graze_radius() + shot->get_radius()) {
-                if (!shot->flagged(Shot::FLAG_GRAZING)) {
-                    hitbox->graze(shot);
-                    shot->flag(Shot::FLAG_GRAZING);
+                float graze_reach = state.graze_radius + radius;
+                if (distance_squared <= graze_reach * graze_reach) {
+                    if (!(grazing & state.bit)) {
+                        state.hitbox->graze(shot, Math::sqrt(distance_squared));
+                        _handle(shot, ShotEffect::EVENT_GRAZE, state.hitbox->get_slot());
+                        grazing |= state.bit;
+                    }
+                } else {
+                    grazing &= ~state.bit;
                 }
-            } else {
-                shot->unflag(Shot::FLAG_GRAZING);
             }
-        }
 
-        // Clear shot if it's either outside the gameplay region or in clear circle
-        if (!region.has_point(shot->get_global_position())) {
-            shot->unflag(Shot::FLAG_ACTIVE);
-            clean = true;
+            shot->set_colliding_hitboxes(colliding);
+            shot->set_grazing_hitboxes(grazing);
         }
+        DANMAKU_PROFILE_END(collision_begin, danmaku, Danmaku::PHASE_COLLISION);
     }
     
-    // Check if bullets collide with physics bodies, expensive, don't use this for patterns with a lot of shots!
-    if (collision_layers) {
+    // Check for shots hitting hurtboxes, only the hurtboxes in the grid cells a shot covers are tested
+    const Vector<Danmaku::HurtboxState>& hurtboxes = danmaku->get_hurtbox_states();
+    if (hurtbox_mask && !hurtboxes.empty()) {
+        DANMAKU_PROFILE_BEGIN(hurtbox_begin);
+        const SpatialGrid& grid = danmaku->get_hurtbox_grid();
+
+        for (int i = 0; i != count; ++i) {
+            Shot* shot = shots[i];
+            if (!shot->flagged(Shot::FLAG_ACTIVE) || shot->flagged(Shot::FLAG_CLEARED)) {
+                continue;
+            }
+
+            Vector2 position = shot->get_global_position();
+            float radius = shot->get_radius();
+            bool hit = false;
+
+            grid.query(Rect2(position - Vector2(radius, radius), Vector2(radius, radius) * 2), [&](int p_item) {
+                const Danmaku::HurtboxState& state = hurtboxes[p_item];
+                if (!(state.layers & hurtbox_mask)) {
+                    return true;
+                }
+                float reach = state.radius + radius;
+                if (position.distance_squared_to(state.position) > reach * reach) {
+                    return true;
+                }
+                state.hurtbox->hurt(shot, shot_damage);
+                hit = true;
+                return piercing;
+            });
+
+            // Piercing shots keep going and deal their damage every tick they overlap a hurtbox
+            if (hit && !piercing) {
+                shot->clear();
+            }
+        }
+        DANMAKU_PROFILE_END(hurtbox_begin, danmaku, Danmaku::PHASE_COLLISION);
+    }
+
+    // Check if bullets collide with walls baked by Danmaku, a single lookup per shot.
+    // Shots with a wall handler are left to it instead of being cleared.
+    if (collision_layers && danmaku->has_static_walls()) {
+        DANMAKU_PROFILE_BEGIN(physics_begin);
+        for (int i = 0; i != count; ++i) {
+            Shot* shot = shots[i];
+            if (!shot->flagged(Shot::FLAG_ACTIVE)) {
+                continue;
+            }
+            Vector2 position = shot->get_global_position();
+            if (danmaku->get_wall_mask(position) & collision_layers) {
+                if (!_handle(shot, ShotEffect::EVENT_WALL, danmaku->get_wall_normal(position, collision_layers))) {
+                    shot->set_speed(0);
+                    shot->clear();
+                }
+            }
+        }
+        DANMAKU_PROFILE_END(physics_begin, danmaku, Danmaku::PHASE_PHYSICS);
+    } else if (collision_layers) {
+        // Otherwise query the physics bodies directly, expensive, don't use this for patterns with a lot of shots!
+        DANMAKU_PROFILE_BEGIN(physics_begin);
         Ref<World2D> world = get_world_2d();
 
         Physics2DDirectSpaceState* ss = world->get_direct_space_state();
         Physics2DDirectSpaceState::ShapeResult results;
 
         for (int i = 0; i != shots.size(); ++i) {
+            // Shots that despawned earlier this tick are only waiting to be released
+            if (!shots[i]->flagged(Shot::FLAG_ACTIVE)) {
+                continue;
+            }
             if (ss->intersect_point(shots[i]->get_global_position(), &results, 1, Set<RID>(), collision_layers)) {
-                shots[i]->set_speed(0);
-                shots[i]->clear();
+                // Points carry no surface, so there's no normal to hand a wall handler here
+                if (!_handle(shots[i], ShotEffect::EVENT_WALL, Vector2())) {
+                    shots[i]->set_speed(0);
+                    shots[i]->clear();
+                }
             }
         }
+        DANMAKU_PROFILE_END(physics_begin, danmaku, Danmaku::PHASE_PHYSICS);
     }
 
     // Shots left danmaku region, release them back to Danmaku
     if (clean) {
+        DANMAKU_PROFILE_BEGIN(compaction_begin);
         for (int i = 0; i != shots.size();) {
             if (!shots[i]->flagged(Shot::FLAG_ACTIVE)) {
                 danmaku->release(shots[i]);
@@ -139,9 +321,22 @@ void Pattern::_tick() {
                 i++;
             }
         }
+        DANMAKU_PROFILE_END(compaction_begin, danmaku, Danmaku::PHASE_COMPACTION);
     }
 
+    _flush_spawns();
+
     update();
+
+#ifdef KDANMAKU_PROFILING
+    uint64_t tick_end = OS::get_singleton()->get_ticks_usec();
+    tick_time = tick_end - tick_begin;
+    total_tick_time += tick_time;
+
+    if (DanmakuTracer* tracer = danmaku->get_tracer()) {
+        tracer->span(get_name(), tick_begin, tick_end);
+    }
+#endif
 }
 
 int Pattern::fill_buffer(real_t*& buf) {
@@ -189,15 +384,32 @@ int Pattern::fill_buffer(real_t*& buf) {
     return shots.size();
 }
 
+uint64_t Pattern::get_tick_time() const {
+    return tick_time;
+}
+
+uint64_t Pattern::get_total_tick_time() const {
+    return total_tick_time;
+}
+
+void Pattern::reset_tick_time() {
+    tick_time = 0;
+    total_tick_time = 0;
+}
+
+int Pattern::get_peak_shot_count() const {
+    return peak_shot_count;
+}
+
+void Pattern::reset_peak_shot_count() {
+    peak_shot_count = shots.size();
+}
+
 void Pattern::play_sfx(const StringName& p_key) {
     ERR_FAIL_NULL(danmaku);
     danmaku->play_sfx(p_key);
 }
 
-Danmaku* Pattern::get_danmaku() const {
-    return danmaku;
-}
-
 void Pattern::remove_from_danmaku() {
     ERR_FAIL_NULL(danmaku);
     for (int i = 0; i != shots.size(); ++i) {
@@ -217,6 +429,7 @@ Ref<Reference> Pattern::get_delegate() const {
 
 void Pattern::set_despawn_distance(float p_despawn_distance) {
     despawn_distance = p_despawn_distance;
+    invalidate_expire_ticks();
 }
 float Pattern::get_despawn_distance() const {
     return despawn_distance;
@@ -236,6 +449,61 @@ uint32_t Pattern::get_collision_layers() const {
     return collision_layers;
 }
 
+void Pattern::set_hurtbox_mask(uint32_t p_hurtbox_mask) {
+    hurtbox_mask = p_hurtbox_mask;
+}
+uint32_t Pattern::get_hurtbox_mask() const {
+    return hurtbox_mask;
+}
+
+void Pattern::set_shot_damage(float p_damage) {
+    shot_damage = p_damage;
+}
+float Pattern::get_shot_damage() const {
+    return shot_damage;
+}
+
+void Pattern::set_piercing(bool p_piercing) {
+    piercing = p_piercing;
+}
+bool Pattern::is_piercing() const {
+    return piercing;
+}
+
+void Pattern::set_cancel_layer(uint32_t p_cancel_layer) {
+    cancel_layer = p_cancel_layer;
+}
+uint32_t Pattern::get_cancel_layer() const {
+    return cancel_layer;
+}
+
+void Pattern::set_cancel_mask(uint32_t p_cancel_mask) {
+    cancel_mask = p_cancel_mask;
+}
+uint32_t Pattern::get_cancel_mask() const {
+    return cancel_mask;
+}
+
+void Pattern::set_seed(int64_t p_seed) {
+    seed = p_seed;
+    update_seed_key();
+}
+int64_t Pattern::get_seed() const {
+    return seed;
+}
+
+void Pattern::update_seed_key() {
+    // Only explicit seeds go in, so a replay fires the same shots however the tree was built
+    seed_key = CounterRNG::hash(danmaku ? danmaku->get_seed() : 0, seed);
+}
+
+void Pattern::set_hitbox_mask(uint32_t p_hitbox_mask) {
+    hitbox_mask = p_hitbox_mask;
+}
+uint32_t Pattern::get_hitbox_mask() const {
+    return hitbox_mask;
+}
+
 void Pattern::set_register(Register p_reg, const Variant& p_value) {
     switch (p_reg) {
         case FIRE_COUNT:    set_fire_count(p_value);    break;
@@ -247,6 +515,14 @@ void Pattern::set_register(Register p_reg, const Variant& p_value) {
         case FIRE_SPEED:    set_fire_speed(p_value);    break;
         case FIRE_PAUSED:   set_fire_paused(p_value);   break;
         case FIRE_AIM:      set_fire_aim(p_value);      break;
+        case FIRE_TARGET:   set_fire_target(p_value);   break;
+        case FIRE_ACCELERATION:     set_fire_acceleration(p_value);     break;
+        case FIRE_ANGULAR_VELOCITY: set_fire_angular_velocity(p_value); break;
+        case FIRE_MIN_SPEED:        set_fire_min_speed(p_value);        break;
+        case FIRE_MAX_SPEED:        set_fire_max_speed(p_value);        break;
+        case FIRE_HOMING:           set_fire_homing(p_value);           break;
+        case FIRE_ROTATION_JITTER:  set_fire_rotation_jitter(p_value);  break;
+        case FIRE_SPEED_JITTER:     set_fire_speed_jitter(p_value);     break;
         default: registers[p_reg >> 2] = p_value;  break;
     }
 }
@@ -262,6 +538,14 @@ Variant Pattern::get_register(Register p_reg) const {
         case FIRE_SPEED:    return get_fire_speed();
         case FIRE_PAUSED:   return get_fire_paused();
         case FIRE_AIM:      return get_fire_aim();
+        case FIRE_TARGET:   return get_fire_target();
+        case FIRE_ACCELERATION:     return get_fire_acceleration();
+        case FIRE_ANGULAR_VELOCITY: return get_fire_angular_velocity();
+        case FIRE_MIN_SPEED:        return get_fire_min_speed();
+        case FIRE_MAX_SPEED:        return get_fire_max_speed();
+        case FIRE_HOMING:           return get_fire_homing();
+        case FIRE_ROTATION_JITTER:  return get_fire_rotation_jitter();
+        case FIRE_SPEED_JITTER:     return get_fire_speed_jitter();
         default: return registers[p_reg >> 2];
     }
 }
@@ -329,6 +613,62 @@ bool Pattern::get_fire_aim() const {
     return fire_params.aim;
 }
 
+void Pattern::set_fire_target(int p_target) {
+    fire_params.target = p_target;
+}
+int Pattern::get_fire_target() const {
+    return fire_params.target;
+}
+
+void Pattern::set_fire_acceleration(float p_acceleration) {
+    fire_params.acceleration = p_acceleration;
+}
+float Pattern::get_fire_acceleration() const {
+    return fire_params.acceleration;
+}
+
+void Pattern::set_fire_angular_velocity(float p_angular_velocity) {
+    fire_params.angular_velocity = p_angular_velocity;
+}
+float Pattern::get_fire_angular_velocity() const {
+    return fire_params.angular_velocity;
+}
+
+void Pattern::set_fire_min_speed(float p_min_speed) {
+    fire_params.min_speed = p_min_speed;
+}
+float Pattern::get_fire_min_speed() const {
+    return fire_params.min_speed;
+}
+
+void Pattern::set_fire_max_speed(float p_max_speed) {
+    fire_params.max_speed = p_max_speed;
+}
+float Pattern::get_fire_max_speed() const {
+    return fire_params.max_speed;
+}
+
+void Pattern::set_fire_homing(float p_homing) {
+    fire_params.homing = p_homing;
+}
+float Pattern::get_fire_homing() const {
+    return fire_params.homing;
+}
+
+void Pattern::set_fire_rotation_jitter(float p_jitter) {
+    fire_params.rotation_jitter = p_jitter;
+}
+float Pattern::get_fire_rotation_jitter() const {
+    return fire_params.rotation_jitter;
+}
+
+void Pattern::set_fire_speed_jitter(float p_jitter) {
+    fire_params.speed_jitter = p_jitter;
+}
+float Pattern::get_fire_speed_jitter() const {
+    return fire_params.speed_jitter;
+}
+
 void Pattern::reset() {
     fire_params.count = 1;
     fire_params.shape = "single";
@@ -339,6 +679,14 @@ void Pattern::reset() {
     fire_params.speed = 0;
     fire_params.paused = false;
     fire_params.aim = false;
+    fire_params.target = -1;
+    fire_params.acceleration = 0;
+    fire_params.angular_velocity = 0;
+    fire_params.min_speed = 0;
+    fire_params.max_speed = 0;
+    fire_params.homing = 0;
+    fire_params.rotation_jitter = 0;
+    fire_params.speed_jitter = 0;
 }
 
 int Pattern::get_shot_count() const {
@@ -387,7 +735,26 @@ void Pattern::auto_direct(float p_offset) {
 
 void Pattern::fire() {
     ERR_FAIL_NULL(danmaku);
+    DANMAKU_PROFILE_BEGIN(fire_begin);
+
+    int fired = shots.size();
+    if (!_fire(NULL, -1)) {
+        return;
+    }
+    fired = shots.size() - fired;
 
+#ifdef KDANMAKU_PROFILING
+    if (DanmakuTracer* tracer = danmaku->get_tracer()) {
+        tracer->span(danmaku->get_fire_trace_name(), fire_begin, OS::get_singleton()->get_ticks_usec(), fired);
+    }
+#else
+    (void)fired;
+#endif
+
+    reset();
+}
+
+bool Pattern::_fire(Shot* const* p_batch, int p_batch_size) {
     void(Pattern::*shape)(Shot*) = &Pattern::shape_custom;
     if (fire_params.shape.length()) {
         switch ((char)fire_params.shape[0]) {
@@ -408,32 +775,144 @@ void Pattern::fire() {
 
     Ref<ShotSprite> sprite = danmaku->get_sprite(fire_params.sprite);
     if (sprite.is_null()) {
-        ERR_FAIL_MSG("No sprite defined, cannot fire");
+        ERR_FAIL_V_MSG(false, "No sprite defined, cannot fire");
     }
 
     float rotation = fire_params.rotation;
     if (fire_params.aim) {
-        Hitbox* hitbox = danmaku->get_hitbox();
-        ERR_FAIL_NULL(hitbox);
+        // A negative target aims at whichever hitbox is closest
+        Hitbox* hitbox = NULL;
+        if (fire_params.target < 0) {
+            hitbox = danmaku->get_nearest_hitbox(get_global_position(), hitbox_mask);
+        } else {
+            hitbox = danmaku->get_hitbox_at(fire_params.target);
+        }
+        ERR_FAIL_NULL_V(hitbox, false);
         rotation += (hitbox->get_global_position() - get_global_position()).angle();
     }
     Vector2 direction = Vector2(Math::cos(rotation), Math::sin(rotation));
 
+    uint64_t key = CounterRNG::hash(seed_key, volley++);
+
     for (int i = 0; i != fire_params.count; ++i) {
-        Shot* shot = danmaku->capture();
+        // Danmaku counts denied captures, so keep asking for the full volley even once the pool runs dry.
+        // Batches were captured up front and already counted, they're just short when the pool ran dry.
+        Shot* shot = NULL;
+        if (p_batch_size < 0) {
+            shot = danmaku->capture();
+        } else if (i < p_batch_size) {
+            shot = p_batch[i];
+        }
+        if (!shot) {
+            continue;
+        }
         shot->reset(this, i);
         shot->set_direction(direction);
         shot->set_sprite(sprite);
         shot->set_speed(fire_params.speed);
+        shot->set_acceleration(fire_params.acceleration);
+        shot->set_angular_velocity(fire_params.angular_velocity);
+        shot->set_min_speed(fire_params.min_speed);
+        shot->set_max_speed(fire_params.max_speed);
+        shot->set_homing(fire_params.homing);
         shot->set_position(fire_params.offset);
         shot->set_effect(fire_params.effect);
         shot->set_paused(fire_params.paused);
         shot->flag(Shot::FLAG_ACTIVE);
+        shot->set_seed(CounterRNG::hash(key, i));
         shots.push_back(shot);
         (this->*shape)(shot);
+
+        // Jitter goes on top of the shape, drawn from counters effects never use
+        if (fire_params.rotation_jitter != 0) {
+            shot->set_rotation(shot->get_rotation() + fire_params.rotation_jitter * CounterRNG::signed_unit(CounterRNG::hash(shot->get_seed(), 0)));
+        }
+        if (fire_params.speed_jitter != 0) {
+            shot->set_speed(shot->get_speed() + fire_params.speed_jitter * CounterRNG::signed_unit(CounterRNG::hash(shot->get_seed(), 1)));
+        }
     }
+    peak_shot_count = MAX(peak_shot_count, shots.size());
+    return true;
+}
 
-    reset();
+bool Pattern::_handle(Shot* p_shot, ShotEffect::Event p_event, const Variant& p_data) {
+    // Shots already being cleared don't react to anything anymore
+    if (p_shot->flagged(Shot::FLAG_CLEARED)) {
+        return false;
+    }
+    Ref<ShotEffect> effect = p_shot->get_effect();
+    if (effect.is_null() || !effect->handles(p_event)) {
+        return false;
+    }
+    effect->handle(p_shot, p_event, p_data);
+    return true;
+}
+
+void Pattern::queue_spawn(ShotEffect* p_effect, int p_volley, Shot* p_shot) {
+    SpawnRequest request;
+    request.effect = Ref<ShotEffect>(p_effect);
+    request.volley = p_volley;
+    request.position = p_shot->get_position();
+    request.rotation = p_shot->get_rotation();
+    spawn_queue.push_back(request);
+}
+
+void Pattern::_flush_spawns() {
+    if (spawn_queue.empty()) {
+        return;
+    }
+    DANMAKU_PROFILE_BEGIN(spawn_begin);
+
+    int total = 0;
+    for (int i = 0; i != spawn_queue.size(); ++i) {
+        total += MAX(spawn_queue[i].effect->get_volley(spawn_queue[i].volley).count, 0);
+    }
+    int captured = danmaku->capture(total, spawn_batch);
+
+    // Volleys are fired through the fire params, so put back whatever a script had set up for its next fire()
+    FireParams saved_params = fire_params;
+    Variant saved_args[4];
+    for (int i = 0; i != 4; ++i) {
+        saved_args[i] = registers[(FIRE_SHAPE0 >> 2) + i];
+    }
+
+    int next = 0;
+    for (int i = 0; i != spawn_queue.size(); ++i) {
+        const SpawnRequest& request = spawn_queue[i];
+        const ShotEffect::Volley& config = request.effect->get_volley(request.volley);
+
+        reset();
+        fire_params.count = config.count;
+        fire_params.shape = config.shape;
+        fire_params.sprite = config.sprite;
+        fire_params.speed = config.speed;
+        fire_params.effect = config.self ? request.effect : config.effect;
+        fire_params.offset = request.position;
+        fire_params.rotation = request.rotation;
+        for (int j = 0; j != 4; ++j) {
+            registers[(FIRE_SHAPE0 >> 2) + j] = config.shape_args[j];
+        }
+
+        int available = CLAMP(captured - next, 0, MAX(config.count, 0));
+        if (!_fire(spawn_batch.ptr() + next, available)) {
+            for (int j = 0; j != available; ++j) {
+                danmaku->release(spawn_batch[next + j]);
+            }
+        }
+        next += available;
+    }
+
+    fire_params = saved_params;
+    for (int i = 0; i != 4; ++i) {
+        registers[(FIRE_SHAPE0 >> 2) + i] = saved_args[i];
+    }
+    spawn_queue.clear();
+
+#ifdef KDANMAKU_PROFILING
+    if (DanmakuTracer* tracer = danmaku->get_tracer()) {
+        tracer->span(danmaku->get_spawn_trace_name(), spawn_begin, OS::get_singleton()->get_ticks_usec(), total);
+    }
+#endif
 }
 
 void Pattern::fire_single() {
@@ -552,6 +1031,9 @@ void Pattern::_bind_methods() {
     ClassDB::bind_method(D_METHOD("get_register", "register"), &Pattern::get_register);
     ClassDB::bind_method(D_METHOD("reset"), &Pattern::reset);
 
+    ClassDB::bind_method(D_METHOD("get_tick_time"), &Pattern::get_tick_time);
+    ClassDB::bind_method(D_METHOD("get_total_tick_time"), &Pattern::get_total_tick_time);
+
     ClassDB::bind_method(D_METHOD("get_shot_count"), &Pattern::get_shot_count);
     ClassDB::bind_method(D_METHOD("get_shot", "id"), &Pattern::get_shot);
     ClassDB::bind_method(D_METHOD("auto_direct", "offset"), &Pattern::auto_direct, 0);
@@ -582,6 +1064,14 @@ void Pattern::_bind_methods() {
     ClassDB::bind_method(D_METHOD("set_fire_speed", "speed"), &Pattern::set_fire_speed);
     ClassDB::bind_method(D_METHOD("set_fire_paused", "paused"), &Pattern::set_fire_paused);
     ClassDB::bind_method(D_METHOD("set_fire_aim", "aim"), &Pattern::set_fire_aim);
+    ClassDB::bind_method(D_METHOD("set_fire_target", "target"), &Pattern::set_fire_target);
+    ClassDB::bind_method(D_METHOD("set_fire_acceleration", "acceleration"), &Pattern::set_fire_acceleration);
+    ClassDB::bind_method(D_METHOD("set_fire_angular_velocity", "angular_velocity"), &Pattern::set_fire_angular_velocity);
+    ClassDB::bind_method(D_METHOD("set_fire_min_speed", "min_speed"), &Pattern::set_fire_min_speed);
+    ClassDB::bind_method(D_METHOD("set_fire_max_speed", "max_speed"), &Pattern::set_fire_max_speed);
+    ClassDB::bind_method(D_METHOD("set_fire_homing", "homing"), &Pattern::set_fire_homing);
+    ClassDB::bind_method(D_METHOD("set_fire_rotation_jitter", "rotation_jitter"), &Pattern::set_fire_rotation_jitter);
+    ClassDB::bind_method(D_METHOD("set_fire_speed_jitter", "speed_jitter"), &Pattern::set_fire_speed_jitter);
 
     ClassDB::bind_method(D_METHOD("get_fire_count"), &Pattern::get_fire_count);
     ClassDB::bind_method(D_METHOD("get_fire_shape"), &Pattern::get_fire_shape);
@@ -592,21 +1082,50 @@ void Pattern::_bind_methods() {
     ClassDB::bind_method(D_METHOD("get_fire_speed"), &Pattern::get_fire_speed);
     ClassDB::bind_method(D_METHOD("get_fire_paused"), &Pattern::get_fire_paused);
     ClassDB::bind_method(D_METHOD("get_fire_aim"), &Pattern::get_fire_aim);
+    ClassDB::bind_method(D_METHOD("get_fire_target"), &Pattern::get_fire_target);
+    ClassDB::bind_method(D_METHOD("get_fire_acceleration"), &Pattern::get_fire_acceleration);
+    ClassDB::bind_method(D_METHOD("get_fire_angular_velocity"), &Pattern::get_fire_angular_velocity);
+    ClassDB::bind_method(D_METHOD("get_fire_min_speed"), &Pattern::get_fire_min_speed);
+    ClassDB::bind_method(D_METHOD("get_fire_max_speed"), &Pattern::get_fire_max_speed);
+    ClassDB::bind_method(D_METHOD("get_fire_homing"), &Pattern::get_fire_homing);
+    ClassDB::bind_method(D_METHOD("get_fire_rotation_jitter"), &Pattern::get_fire_rotation_jitter);
+    ClassDB::bind_method(D_METHOD("get_fire_speed_jitter"), &Pattern::get_fire_speed_jitter);
 
     ClassDB::bind_method(D_METHOD("set_delegate", "delegate"), &Pattern::set_delegate);
     ClassDB::bind_method(D_METHOD("set_despawn_distance", "despawn_distance"), &Pattern::set_despawn_distance);
     ClassDB::bind_method(D_METHOD("set_autodelete", "autodelete"), &Pattern::set_autodelete);
     ClassDB::bind_method(D_METHOD("set_collision_layers", "collision_layers"), &Pattern::set_collision_layers);
+    ClassDB::bind_method(D_METHOD("set_hitbox_mask", "hitbox_mask"), &Pattern::set_hitbox_mask);
+    ClassDB::bind_method(D_METHOD("set_hurtbox_mask", "hurtbox_mask"), &Pattern::set_hurtbox_mask);
+    ClassDB::bind_method(D_METHOD("set_shot_damage", "shot_damage"), &Pattern::set_shot_damage);
+    ClassDB::bind_method(D_METHOD("set_piercing", "piercing"), &Pattern::set_piercing);
+    ClassDB::bind_method(D_METHOD("set_cancel_layer", "cancel_layer"), &Pattern::set_cancel_layer);
+    ClassDB::bind_method(D_METHOD("set_cancel_mask", "cancel_mask"), &Pattern::set_cancel_mask);
+    ClassDB::bind_method(D_METHOD("set_seed", "seed"), &Pattern::set_seed);
 
     ClassDB::bind_method(D_METHOD("get_delegate"), &Pattern::get_delegate);
     ClassDB::bind_method(D_METHOD("get_despawn_distance"), &Pattern::get_despawn_distance);
     ClassDB::bind_method(D_METHOD("get_autodelete"), &Pattern::get_autodelete);
     ClassDB::bind_method(D_METHOD("get_collision_layers"), &Pattern::get_collision_layers);
+    ClassDB::bind_method(D_METHOD("get_hitbox_mask"), &Pattern::get_hitbox_mask);
+    ClassDB::bind_method(D_METHOD("get_hurtbox_mask"), &Pattern::get_hurtbox_mask);
+    ClassDB::bind_method(D_METHOD("get_shot_damage"), &Pattern::get_shot_damage);
+    ClassDB::bind_method(D_METHOD("is_piercing"), &Pattern::is_piercing);
+    ClassDB::bind_method(D_METHOD("get_cancel_layer"), &Pattern::get_cancel_layer);
+    ClassDB::bind_method(D_METHOD("get_cancel_mask"), &Pattern::get_cancel_mask);
+    ClassDB::bind_method(D_METHOD("get_seed"), &Pattern::get_seed);
 
     ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "delegate"), "set_delegate", "get_delegate");
     ADD_PROPERTY(PropertyInfo(Variant::REAL, "despawn_distance"), "set_despawn_distance", "get_despawn_distance");
     ADD_PROPERTY(PropertyInfo(Variant::BOOL, "autodelete"), "set_autodelete", "get_autodelete");
     ADD_PROPERTY(PropertyInfo(Variant::INT, "collision_layers"), "set_collision_layers", "get_collision_layers");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "hitbox_mask", PROPERTY_HINT_LAYERS_2D_PHYSICS), "set_hitbox_mask", "get_hitbox_mask");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "hurtbox_mask", PROPERTY_HINT_LAYERS_2D_PHYSICS), "set_hurtbox_mask", "get_hurtbox_mask");
+    ADD_PROPERTY(PropertyInfo(Variant::REAL, "shot_damage"), "set_shot_damage", "get_shot_damage");
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "piercing"), "set_piercing", "is_piercing");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "cancel_layer", PROPERTY_HINT_LAYERS_2D_PHYSICS), "set_cancel_layer", "get_cancel_layer");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "cancel_mask", PROPERTY_HINT_LAYERS_2D_PHYSICS), "set_cancel_mask", "get_cancel_mask");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "seed"), "set_seed", "get_seed");
 
     ADD_PROPERTY(PropertyInfo(Variant::INT, "fire_count"), "set_fire_count", "get_fire_count");
     ADD_PROPERTY(PropertyInfo(Variant::STRING, "fire_shape"), "set_fire_shape", "get_fire_shape");
@@ -617,6 +1136,14 @@ void Pattern::_bind_methods() {
     ADD_PROPERTY(PropertyInfo(Variant::REAL, "fire_speed"), "set_fire_speed", "get_fire_speed");
     ADD_PROPERTY(PropertyInfo(Variant::BOOL, "fire_paused"), "set_fire_paused", "get_fire_paused");
     ADD_PROPERTY(PropertyInfo(Variant::BOOL, "fire_aim"), "set_fire_aim", "get_fire_aim");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "fire_target"), "set_fire_target", "get_fire_target");
+    ADD_PROPERTY(PropertyInfo(Variant::REAL, "fire_acceleration"), "set_fire_acceleration", "get_fire_acceleration");
+    ADD_PROPERTY(PropertyInfo(Variant::REAL, "fire_angular_velocity"), "set_fire_angular_velocity", "get_fire_angular_velocity");
+    ADD_PROPERTY(PropertyInfo(Variant::REAL, "fire_min_speed"), "set_fire_min_speed", "get_fire_min_speed");
+    ADD_PROPERTY(PropertyInfo(Variant::REAL, "fire_max_speed"), "set_fire_max_speed", "get_fire_max_speed");
+    ADD_PROPERTY(PropertyInfo(Variant::REAL, "fire_homing"), "set_fire_homing", "get_fire_homing");
+    ADD_PROPERTY(PropertyInfo(Variant::REAL, "fire_rotation_jitter"), "set_fire_rotation_jitter", "get_fire_rotation_jitter");
+    ADD_PROPERTY(PropertyInfo(Variant::REAL, "fire_speed_jitter"), "set_fire_speed_jitter", "get_fire_speed_jitter");
 
     BIND_CONSTANT(REG0);
     BIND_CONSTANT(REG1);
@@ -641,6 +1168,14 @@ void Pattern::_bind_methods() {
     BIND_CONSTANT(FIRE_SPEED);
     BIND_CONSTANT(FIRE_PAUSED);
     BIND_CONSTANT(FIRE_AIM);
+    BIND_CONSTANT(FIRE_TARGET);
+    BIND_CONSTANT(FIRE_ACCELERATION);
+    BIND_CONSTANT(FIRE_ANGULAR_VELOCITY);
+    BIND_CONSTANT(FIRE_MIN_SPEED);
+    BIND_CONSTANT(FIRE_MAX_SPEED);
+    BIND_CONSTANT(FIRE_HOMING);
+    BIND_CONSTANT(FIRE_ROTATION_JITTER);
+    BIND_CONSTANT(FIRE_SPEED_JITTER);
 }
 
 Pattern::Pattern() {
@@ -649,7 +1184,20 @@ Pattern::Pattern() {
     despawn_distance = 0;
     autodelete = false;
     collision_layers = 0;
+    hitbox_mask = 1;
+    hurtbox_mask = 0;
+    shot_damage = 1;
+    piercing = false;
+    cancel_layer = 0;
+    cancel_mask = 0;
+    seed = 0;
+    seed_key = 0;
+    volley = 0;
     effect_count = 0;
+    tick_time = 0;
+    total_tick_time = 0;
+    peak_shot_count = 0;
 
+    set_notify_transform(true);
     reset();
 }
\ No newline at end of file
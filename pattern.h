@@ -26,7 +26,7 @@ class Pattern : public Node2D {
     Vector<Shot*> shots;
     Ref<Reference> delegate;
 
-    struct {
+    struct FireParams {
         int count;
         String shape;
         String sprite;
@@ -36,6 +36,14 @@ class Pattern : public Node2D {
         float speed;
         bool paused;
         bool aim;
+        int target;
+        float acceleration;
+        float angular_velocity;
+        float min_speed;
+        float max_speed;
+        float homing;
+        float rotation_jitter;
+        float speed_jitter;
     } fire_params;
 
     int effect_count;
@@ -44,6 +52,33 @@ class Pattern : public Node2D {
     float despawn_distance;
     bool autodelete;
     uint32_t collision_layers;
+    uint32_t hitbox_mask;
+    uint32_t hurtbox_mask;
+    float shot_damage;
+    bool piercing;
+    uint32_t cancel_layer;
+    uint32_t cancel_mask;
+
+    uint64_t motion_tick;
+
+    // Volleys fired by shot effects, fired together once the tick's shots have moved and collided
+    struct SpawnRequest {
+        Ref<ShotEffect> effect;
+        int volley;
+        Vector2 position;
+        float rotation;
+    };
+    Vector<SpawnRequest> spawn_queue;
+    Vector<Shot*> spawn_batch;
+
+    // Shots are keyed by the Danmaku seed, this Pattern's seed, and the volley they were fired in
+    int64_t seed;
+    uint64_t seed_key;
+    uint64_t volley;
+
+    int peak_shot_count;
+    uint64_t tick_time;
+    uint64_t total_tick_time;
 
 protected:
     void _notification(int p_what);
@@ -73,7 +108,17 @@ public:
         FIRE_ROTATION = PATTERN_REG(17),
         FIRE_SPEED    = PATTERN_REG(18),
         FIRE_PAUSED   = PATTERN_REG(19),
-        FIRE_AIM      = PATTERN_REG(20)
+        FIRE_AIM      = PATTERN_REG(20),
+        FIRE_TARGET   = PATTERN_REG(21),
+
+        FIRE_ACCELERATION     = PATTERN_REG(22),
+        FIRE_ANGULAR_VELOCITY = PATTERN_REG(23),
+        FIRE_MIN_SPEED        = PATTERN_REG(24),
+        FIRE_MAX_SPEED        = PATTERN_REG(25),
+        FIRE_HOMING           = PATTERN_REG(26),
+
+        FIRE_ROTATION_JITTER = PATTERN_REG(27),
+        FIRE_SPEED_JITTER    = PATTERN_REG(28)
     };
 
     void set_register(Register p_reg, const Variant& p_value);
@@ -106,6 +151,30 @@ public:
     void set_fire_aim(bool p_aim);
     bool get_fire_aim() const;
 
+    void set_fire_target(int p_target);
+    int get_fire_target() const;
+
+    void set_fire_acceleration(float p_acceleration);
+    float get_fire_acceleration() const;
+
+    void set_fire_angular_velocity(float p_angular_velocity);
+    float get_fire_angular_velocity() const;
+
+    void set_fire_min_speed(float p_min_speed);
+    float get_fire_min_speed() const;
+
+    void set_fire_max_speed(float p_max_speed);
+    float get_fire_max_speed() const;
+
+    void set_fire_homing(float p_homing);
+    float get_fire_homing() const;
+
+    void set_fire_rotation_jitter(float p_jitter);
+    float get_fire_rotation_jitter() const;
+
+    void set_fire_speed_jitter(float p_jitter);
+    float get_fire_speed_jitter() const;
+
     int get_shot_count() const;
     Shot* get_shot(int p_id) const;
     Variant _call_shots(const Variant **p_args, int p_argcount, Variant::CallError &r_error);
@@ -122,6 +191,8 @@ public:
 
     void reset();
 
+    void queue_spawn(ShotEffect* p_effect, int p_volley, Shot* p_shot);
+
     void shape_single(Shot* p_shot);
     void shape_circle(Shot* p_shot);
     void shape_fan(Shot* p_shot);
@@ -135,7 +206,7 @@ public:
 
     void play_sfx(const StringName& p_key);
 
-    Danmaku* get_danmaku() const;
+    _FORCE_INLINE_ Danmaku* get_danmaku() const { return danmaku; }
     void remove_from_danmaku();
 
     void set_delegate(Ref<Reference> p_delegate);
@@ -150,12 +221,53 @@ public:
     void set_collision_layers(uint32_t p_collision_layers);
     uint32_t get_collision_layers() const;
 
+    void set_hitbox_mask(uint32_t p_hitbox_mask);
+    uint32_t get_hitbox_mask() const;
+
+    void set_hurtbox_mask(uint32_t p_hurtbox_mask);
+    uint32_t get_hurtbox_mask() const;
+
+    void set_shot_damage(float p_damage);
+    float get_shot_damage() const;
+
+    void set_piercing(bool p_piercing);
+    bool is_piercing() const;
+
+    void set_cancel_layer(uint32_t p_cancel_layer);
+    uint32_t get_cancel_layer() const;
+
+    void set_cancel_mask(uint32_t p_cancel_mask);
+    uint32_t get_cancel_mask() const;
+
+    void set_seed(int64_t p_seed);
+    int64_t get_seed() const;
+    void update_seed_key();
+
     int fill_buffer(real_t*& buf);
 
-    Pattern();
+    int get_peak_shot_count() const;
+    void reset_peak_shot_count();
+
+    uint64_t get_tick_time() const;
+    uint64_t get_total_tick_time() const;
+    void reset_tick_time();
+
+    // The tick that shot positions currently belong to, linear shots are evaluated at this tick
+    _FORCE_INLINE_ uint64_t get_motion_tick() const { return motion_tick; }
+    // Linear shots solve for when they leave the region, which has to be redone once either side moves
+    void invalidate_expire_ticks();
 
-private:
     void _tick();
+
+private:
+    // Captures shots one by one when p_batch_size is negative, otherwise takes them from p_batch
+    bool _fire(Shot* const* p_batch, int p_batch_size);
+    void _flush_spawns();
+    bool _handle(Shot* p_shot, ShotEffect::Event p_event, const Variant& p_data);
+
+public:
+
+    Pattern();
 };
 
 // ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
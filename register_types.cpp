@@ -4,9 +4,17 @@
 #include "shot_sprite.h"
 #include "shot.h"
 #include "shot_effect.h"
+#include "shot_effect_format.h"
+#include "shot_effect_aot.h"
 #include "hitbox.h"
+#include "hurtbox.h"
+#include "laser.h"
 #include "danmaku.h"
 #include "pattern.h"
+#include "benchmark.h"
+
+static Ref<ResourceFormatLoaderShotEffect> shot_effect_loader;
+static Ref<ResourceFormatSaverShotEffect> shot_effect_saver;
 
 void register_kdanmaku_types() {
     ClassDB::register_class<Frames>();
@@ -14,9 +22,23 @@ void register_kdanmaku_types() {
     ClassDB::register_class<Shot>();
     ClassDB::register_class<ShotEffect>();
     ClassDB::register_class<Hitbox>();
+    ClassDB::register_class<Hurtbox>();
     ClassDB::register_class<Danmaku>();
     ClassDB::register_class<Pattern>();
+    ClassDB::register_class<Laser>();
+    ClassDB::register_class<DanmakuBenchmark>();
+
+    register_aot_effects();
+
+    shot_effect_loader.instance();
+    ResourceLoader::add_resource_format_loader(shot_effect_loader);
+    shot_effect_saver.instance();
+    ResourceSaver::add_resource_format_saver(shot_effect_saver);
 }
 
 void unregister_kdanmaku_types() {
+    ResourceLoader::remove_resource_format_loader(shot_effect_loader);
+    shot_effect_loader.unref();
+    ResourceSaver::remove_resource_format_saver(shot_effect_saver);
+    shot_effect_saver.unref();
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "shot.h"
 #include "danmaku.h"
 #include "pattern.h"
+#include "shot_effect_opcodes.h"
 
 #include "core/math/math_funcs.h"
 
@@ -8,30 +9,61 @@ void Shot::reset(Pattern* p_owner, int p_id) {
     id = p_id;
     owner = p_owner;
     flags = 0;
+    seed = 0;
+    draw_tick = 0;
+    draws = 0;
+    colliding_hitboxes = 0;
+    grazing_hitboxes = 0;
     speed = 0;
     sprite = Ref<ShotSprite>();
     effect = Ref<ShotEffect>();
     position = Vector2(0, 0);
     global_position = Vector2(0, 0);
     direction = Vector2(0, 1);
+    acceleration = 0;
+    angular_velocity = 0;
+    min_speed = 0;
+    max_speed = 0;
+    homing = 0;
+    origin_tick = 0;
+    expire_tick = UINT64_MAX;
+    global_tick = 0;
 
     for (int i = 0; i != SHOT_REGISTERS; ++i) {
         registers[i] = Variant();
     }
+    event = Variant();
 
     for (int i = 0; i != MAX_SHOT_EFFECTS; ++i) {
         instruction_pointers[i] = -1;
+        sleeps[i].wake = 0;
     }
+    wake_tick = 0;
 }
 
 void Shot::set_register(Register p_reg, const Variant& p_value) {
+    // Writing to a timer that's being slept on restarts the countdown from the new value next tick
+    for (int i = 0; i != MAX_SHOT_EFFECTS; ++i) {
+        if (sleeps[i].wake && sleeps[i].reg == p_reg) {
+            sleeps[i].wake = 0;
+            wake_tick = 0;
+        }
+    }
+
     switch (p_reg) {
         case POSITION:  set_position(p_value);   break;
         case SPEED:     set_speed(p_value);      break;
         case DIRECTION: set_direction(p_value);  break;
         case ROTATION:  set_rotation(p_value);   break;
         case VELOCITY:  set_velocity(p_value);   break;
+        case PAUSED:    set_paused(p_value);     break;
         case SPRITE:    set_sprite_key(p_value); break;
+        case ACCELERATION:     set_acceleration(p_value);     break;
+        case ANGULAR_VELOCITY: set_angular_velocity(p_value); break;
+        case MIN_SPEED:        set_min_speed(p_value);        break;
+        case MAX_SPEED:        set_max_speed(p_value);        break;
+        case HOMING:           set_homing(p_value);           break;
+        case EVENT:            event = p_value;               break;
         default: registers[p_reg >> 2] = p_value; break;
     }
 }
@@ -43,13 +75,159 @@ Variant Shot::get_register(Register p_reg) const {
         case DIRECTION: return get_direction();
         case ROTATION:  return get_rotation();
         case VELOCITY:  return get_velocity();
+        case PAUSED:    return get_paused();
         case SPRITE:    return get_sprite_key();
-        default: return registers[p_reg >> 2];
+        case ACCELERATION:     return get_acceleration();
+        case ANGULAR_VELOCITY: return get_angular_velocity();
+        case MIN_SPEED:        return get_min_speed();
+        case MAX_SPEED:        return get_max_speed();
+        case HOMING:           return get_homing();
+        case EVENT:            return event;
+        default: break;
+    }
+
+    for (int i = 0; i != MAX_SHOT_EFFECTS; ++i) {
+        if (sleeps[i].wake && sleeps[i].reg == p_reg) {
+            return _get_sleeping_timer(sleeps[i], get_danmaku()->get_tick());
+        }
+    }
+    return registers[p_reg >> 2];
+}
+
+void Shot::sleep(int p_pass, Register p_reg, const Variant& p_timer, uint64_t p_tick, Variant* p_state) {
+    Sleep& sleep = sleeps[p_pass];
+    sleep.reg = p_reg;
+    sleep.state = p_state;
+    sleep.value = p_timer;
+    sleep.integer = p_timer.get_type() == Variant::INT;
+    sleep.start = p_tick;
+
+    // Counting down by one each tick, the timer first stops being positive after ceil(value) ticks
+    sleep.wake = p_tick + (uint64_t)Math::ceil(sleep.value);
+}
+
+Variant Shot::wake(int p_pass) {
+    Sleep& sleep = sleeps[p_pass];
+    Variant timer = _get_sleeping_timer(sleep, sleep.wake - 1);
+    sleep.wake = 0;
+    return timer;
+}
+
+void Shot::update_wake_tick() {
+    // Finished passes never wake again, so a shot whose passes have all ended sleeps forever
+    wake_tick = UINT64_MAX;
+    for (int i = 0; i != MAX_SHOT_EFFECTS; ++i) {
+        if (instruction_pointers[i] != -1) {
+            wake_tick = MIN(wake_tick, sleeps[i].wake);
+        }
+    }
+}
+
+void Shot::set_state_register(Register p_reg, Variant* p_state, const Variant& p_value) {
+    // Same as shot registers, writing to a timer that's being slept on restarts the countdown
+    for (int i = 0; i != MAX_SHOT_EFFECTS; ++i) {
+        if (sleeps[i].wake && sleeps[i].reg == p_reg && sleeps[i].state == p_state) {
+            sleeps[i].wake = 0;
+            wake_tick = 0;
+        }
+    }
+    p_state[REG_IDX(p_reg)] = p_value;
+}
+
+Variant Shot::get_state_register(Register p_reg, const Variant* p_state) const {
+    for (int i = 0; i != MAX_SHOT_EFFECTS; ++i) {
+        if (sleeps[i].wake && sleeps[i].reg == p_reg && sleeps[i].state == p_state) {
+            return _get_sleeping_timer(sleeps[i], get_danmaku()->get_tick());
+        }
+    }
+    return p_state[REG_IDX(p_reg)];
+}
+
+uint32_t Shot::get_sleeping_registers() const {
+    // Bit i is set while a pass sleeps on REGi, which then has to be read through get_register
+    uint32_t mask = 0;
+    for (int i = 0; i != MAX_SHOT_EFFECTS; ++i) {
+        if (sleeps[i].wake && REG_SRC(sleeps[i].reg) == REG_SHOT) {
+            mask |= 1 << REG_IDX(sleeps[i].reg);
+        }
+    }
+    return mask;
+}
+
+void Shot::_settle_sleeps() {
+    for (int i = 0; i != MAX_SHOT_EFFECTS; ++i) {
+        Sleep& sleep = sleeps[i];
+        if (!sleep.wake) {
+            continue;
+        }
+        Variant timer = _get_sleeping_timer(sleep, get_danmaku()->get_tick());
+        if (REG_SRC(sleep.reg) == REG_STATE) {
+            sleep.state[REG_IDX(sleep.reg)] = timer;
+        } else {
+            registers[REG_IDX(sleep.reg)] = timer;
+        }
+        sleep.wake = 0;
+    }
+    wake_tick = 0;
+}
+
+Variant Shot::_get_sleeping_timer(const Sleep& p_sleep, uint64_t p_tick) const {
+    // The value the register would hold had it been decremented once per tick since the sleep began
+    double value = p_sleep.value - (double)(MIN(p_tick, p_sleep.wake - 1) - p_sleep.start + 1);
+    if (p_sleep.integer) {
+        return (int64_t)value;
+    }
+    return value;
+}
+
+void Shot::linearize(uint64_t p_tick, const Transform2D& p_transform, const Rect2& p_region) {
+    // p_tick is the tick the shot's current position belongs to
+    origin = position;
+    origin_tick = p_tick;
+    flag(FLAG_LINEAR | FLAG_UPDATE_GLOBAL);
+    update_expire_tick(p_tick, p_transform, p_region);
+}
+
+void Shot::update_expire_tick(uint64_t p_tick, const Transform2D& p_transform, const Rect2& p_region) {
+    Vector2 from = p_transform.xform(origin + get_velocity() * (float)(p_tick - origin_tick));
+    Vector2 velocity = p_transform.basis_xform(get_velocity());
+
+    // Moving in a straight line, the shot leaves the region when it crosses the first slab edge in its way
+    double exit = 1e18;
+    if (velocity.x > 0) {
+        exit = MIN(exit, (p_region.position.x + p_region.size.x - from.x) / velocity.x);
+    } else if (velocity.x < 0) {
+        exit = MIN(exit, (p_region.position.x - from.x) / velocity.x);
+    }
+    if (velocity.y > 0) {
+        exit = MIN(exit, (p_region.position.y + p_region.size.y - from.y) / velocity.y);
+    } else if (velocity.y < 0) {
+        exit = MIN(exit, (p_region.position.y - from.y) / velocity.y);
+    }
+
+    if (exit >= 1e18) {
+        // A shot sitting still never leaves by itself, but the pattern carrying it still can
+        expire_tick = p_tick + 1;
+    } else {
+        expire_tick = p_tick + (uint64_t)MAX(Math::floor(exit), 0.0) + 1;
+    }
+}
+
+void Shot::_unlinearize() {
+    if (flagged(FLAG_LINEAR)) {
+        position = get_position();
+        unflag(FLAG_LINEAR);
+        flag(FLAG_UPDATE_GLOBAL);
     }
 }
 
 void Shot::set_effect(Ref<ShotEffect> p_effect) {
+    _unlinearize();
     effect = p_effect;
+    for (int i = 0; i != MAX_SHOT_EFFECTS; ++i) {
+        sleeps[i].wake = 0;
+    }
+    wake_tick = 0;
     if (p_effect.is_valid()) {
         for (int i = 0; i != p_effect->get_pass_count(); ++i) {
             instruction_pointers[i] = 0;
@@ -71,7 +249,12 @@ Danmaku* Shot::get_danmaku() const {
 }
 
 void Shot::set_paused(bool p_paused) {
+    _unlinearize();
     if (p_paused) {
+        // Wake ticks keep running while paused, so settle sleeping timers now and let them sleep again on unpause
+        if (!flagged(FLAG_PAUSED)) {
+            _settle_sleeps();
+        }
         flag(FLAG_PAUSED);
     } else {
         unflag(FLAG_PAUSED);
@@ -106,23 +289,34 @@ String Shot::get_sprite_key() const {
 }
 
 void Shot::set_position(const Vector2& p_position) {
+    unflag(FLAG_LINEAR);
     flag(FLAG_UPDATE_GLOBAL);
     position = p_position;
+    get_danmaku()->invalidate_shot_grid();
 }
 
 Vector2 Shot::get_position() const {
+    if (flagged(FLAG_LINEAR)) {
+        return origin + get_velocity() * (float)(owner->get_motion_tick() - origin_tick);
+    }
     return position;
 }
 
 Vector2 Shot::get_global_position() {
+    // Linear shots move without being touched, so their global position goes stale every tick
+    if (flagged(FLAG_LINEAR) && global_tick != owner->get_motion_tick()) {
+        global_tick = owner->get_motion_tick();
+        flag(FLAG_UPDATE_GLOBAL);
+    }
     if (flagged(FLAG_UPDATE_GLOBAL)) {
-        global_position = owner->get_global_transform().xform(position);
+        global_position = owner->get_global_transform().xform(get_position());
         unflag(FLAG_UPDATE_GLOBAL);
     }
     return global_position;
 }
 
 void Shot::set_speed(float p_speed) {
+    _unlinearize();
     speed = p_speed;
 }
 
@@ -131,6 +325,7 @@ float Shot::get_speed() const {
 }
 
 void Shot::set_direction(const Vector2& p_direction) {
+    _unlinearize();
     direction = p_direction;
 }
 
@@ -139,6 +334,7 @@ Vector2 Shot::get_direction() const {
 }
 
 void Shot::set_rotation(float p_rotation) {
+    _unlinearize();
     direction = Vector2(Math::cos(p_rotation), Math::sin(p_rotation));
 }
 
@@ -147,6 +343,7 @@ float Shot::get_rotation() const {
 }
 
 void Shot::set_velocity(const Vector2& p_velocity) {
+    _unlinearize();
     speed = p_velocity.length();
     direction = p_velocity / speed;
 }
@@ -164,6 +361,61 @@ void Shot::clear() {
             unflag(FLAG_ACTIVE);
         }
         flag(FLAG_CLEARED);
+        get_danmaku()->invalidate_shot_grid();
+    }
+}
+
+void Shot::set_acceleration(float p_acceleration) {
+    _unlinearize();
+    acceleration = p_acceleration;
+    _update_kinematic();
+}
+
+float Shot::get_acceleration() const {
+    return acceleration;
+}
+
+void Shot::set_angular_velocity(float p_angular_velocity) {
+    _unlinearize();
+    angular_velocity = p_angular_velocity;
+    _update_kinematic();
+}
+
+float Shot::get_angular_velocity() const {
+    return angular_velocity;
+}
+
+void Shot::set_min_speed(float p_min_speed) {
+    min_speed = p_min_speed;
+}
+
+float Shot::get_min_speed() const {
+    return min_speed;
+}
+
+void Shot::set_max_speed(float p_max_speed) {
+    max_speed = p_max_speed;
+}
+
+float Shot::get_max_speed() const {
+    return max_speed;
+}
+
+void Shot::set_homing(float p_homing) {
+    _unlinearize();
+    homing = p_homing;
+    _update_kinematic();
+}
+
+float Shot::get_homing() const {
+    return homing;
+}
+
+void Shot::_update_kinematic() {
+    if (acceleration != 0 || angular_velocity != 0 || homing > 0) {
+        flag(FLAG_KINEMATIC);
+    } else {
+        unflag(FLAG_KINEMATIC);
     }
 }
 
@@ -181,6 +433,11 @@ void Shot::_bind_methods() {
     ClassDB::bind_method(D_METHOD("set_velocity", "velocity"), &Shot::set_velocity);
     ClassDB::bind_method(D_METHOD("set_rotation", "rotation"), &Shot::set_rotation);
     ClassDB::bind_method(D_METHOD("set_sprite", "sprite"), &Shot::set_sprite_key);
+    ClassDB::bind_method(D_METHOD("set_acceleration", "acceleration"), &Shot::set_acceleration);
+    ClassDB::bind_method(D_METHOD("set_angular_velocity", "angular_velocity"), &Shot::set_angular_velocity);
+    ClassDB::bind_method(D_METHOD("set_min_speed", "min_speed"), &Shot::set_min_speed);
+    ClassDB::bind_method(D_METHOD("set_max_speed", "max_speed"), &Shot::set_max_speed);
+    ClassDB::bind_method(D_METHOD("set_homing", "homing"), &Shot::set_homing);
 
     ClassDB::bind_method(D_METHOD("get_paused"), &Shot::get_paused);
     ClassDB::bind_method(D_METHOD("get_speed"), &Shot::get_speed);
@@ -189,6 +446,11 @@ void Shot::_bind_methods() {
     ClassDB::bind_method(D_METHOD("get_velocity"), &Shot::get_velocity);
     ClassDB::bind_method(D_METHOD("get_rotation"), &Shot::get_rotation);
     ClassDB::bind_method(D_METHOD("get_sprite"), &Shot::get_sprite_key);
+    ClassDB::bind_method(D_METHOD("get_acceleration"), &Shot::get_acceleration);
+    ClassDB::bind_method(D_METHOD("get_angular_velocity"), &Shot::get_angular_velocity);
+    ClassDB::bind_method(D_METHOD("get_min_speed"), &Shot::get_min_speed);
+    ClassDB::bind_method(D_METHOD("get_max_speed"), &Shot::get_max_speed);
+    ClassDB::bind_method(D_METHOD("get_homing"), &Shot::get_homing);
 
     ClassDB::bind_method(D_METHOD("clear"), &Shot::clear);
 
@@ -199,6 +461,11 @@ void Shot::_bind_methods() {
     ADD_PROPERTY(PropertyInfo(Variant::VECTOR2, "velocity"), "set_velocity", "get_velocity");
     ADD_PROPERTY(PropertyInfo(Variant::REAL, "rotation"), "set_rotation", "get_rotation");
     ADD_PROPERTY(PropertyInfo(Variant::STRING, "sprite"), "set_sprite", "get_sprite");
+    ADD_PROPERTY(PropertyInfo(Variant::REAL, "acceleration"), "set_acceleration", "get_acceleration");
+    ADD_PROPERTY(PropertyInfo(Variant::REAL, "angular_velocity"), "set_angular_velocity", "get_angular_velocity");
+    ADD_PROPERTY(PropertyInfo(Variant::REAL, "min_speed"), "set_min_speed", "get_min_speed");
+    ADD_PROPERTY(PropertyInfo(Variant::REAL, "max_speed"), "set_max_speed", "get_max_speed");
+    ADD_PROPERTY(PropertyInfo(Variant::REAL, "homing"), "set_homing", "get_homing");
 
     BIND_CONSTANT(REG0);
     BIND_CONSTANT(REG1);
@@ -215,8 +482,15 @@ void Shot::_bind_methods() {
     BIND_CONSTANT(VELOCITY);
     BIND_CONSTANT(PAUSED);
     BIND_CONSTANT(SPRITE);
+    BIND_CONSTANT(ACCELERATION);
+    BIND_CONSTANT(ANGULAR_VELOCITY);
+    BIND_CONSTANT(MIN_SPEED);
+    BIND_CONSTANT(MAX_SPEED);
+    BIND_CONSTANT(HOMING);
+    BIND_CONSTANT(EVENT);
 }
 
 Shot::Shot() {
+    spawn_tick = 0;
     reset(NULL, 0);
 }
\ No newline at end of file
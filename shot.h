@@ -25,11 +25,34 @@ class Shot : public Object {
     int id;
     Pattern* owner;
     uint32_t flags;
+    uint64_t spawn_tick;
+    uint64_t seed;
+
+    // Random numbers drawn by effects this tick, so a rand in a loop draws a new number each time
+    uint64_t draw_tick;
+    uint32_t draws;
+
+    // One bit per Danmaku hitbox slot, FLAG_COLLIDING and FLAG_GRAZING are set while any bit is
+    uint32_t colliding_hitboxes;
+    uint32_t grazing_hitboxes;
+
+    // An effect pass blocked on a timer sleeps until its wake tick instead of counting down every tick
+    struct Sleep {
+        uint64_t wake;
+        uint64_t start;
+        double value;
+        Variant* state;
+        Register reg;
+        bool integer;
+    };
 
     Ref<ShotEffect> effect;
     int instruction_pointers[MAX_SHOT_EFFECTS];
+    Sleep sleeps[MAX_SHOT_EFFECTS];
+    uint64_t wake_tick;
     Variant registers[SHOT_REGISTERS];
     Variant state[STATE_REGISTERS];
+    Variant event;
 
     Ref<ShotSprite> sprite;
     ShotFrame frame;
@@ -39,6 +62,19 @@ class Shot : public Object {
     Vector2 direction;
     float speed;
 
+    // While FLAG_LINEAR is set, position is origin + velocity * ticks since origin_tick instead
+    Vector2 origin;
+    uint64_t origin_tick;
+    uint64_t expire_tick;
+    uint64_t global_tick;
+
+    // Integrated natively by Pattern every tick, see FLAG_KINEMATIC
+    float acceleration;
+    float angular_velocity;
+    float min_speed;
+    float max_speed;
+    float homing;
+
 protected:
     static void _bind_methods();
 
@@ -58,7 +94,16 @@ public:
         ROTATION  = SHOT_REG(11),
         VELOCITY  = SHOT_REG(12),
         PAUSED    = SHOT_REG(13),
-        SPRITE    = SHOT_REG(14)
+        SPRITE    = SHOT_REG(14),
+
+        ACCELERATION     = SHOT_REG(15),
+        ANGULAR_VELOCITY = SHOT_REG(16),
+        MIN_SPEED        = SHOT_REG(17),
+        MAX_SPEED        = SHOT_REG(18),
+        HOMING           = SHOT_REG(19),
+
+        // What the event an effect handler is running for was about, see ShotEffect.on()
+        EVENT = SHOT_REG(20)
     };
 
     enum {
@@ -67,7 +112,9 @@ public:
         FLAG_GRAZING   = 4,
         FLAG_COLLIDING = 8,
         FLAG_PAUSED    = 16,
-        FLAG_UPDATE_GLOBAL = 32
+        FLAG_UPDATE_GLOBAL = 32,
+        FLAG_KINEMATIC     = 64,
+        FLAG_LINEAR        = 128
     };
 
     _FORCE_INLINE_ void flag(int p_flag)     { flags |= p_flag;  }
@@ -75,11 +122,69 @@ public:
     _FORCE_INLINE_ bool flagged(int p_flag) const { return flags & p_flag; }
 
     _FORCE_INLINE_ int get_id() { return id; }
+    _FORCE_INLINE_ uint64_t get_spawn_tick() const { return spawn_tick; }
+    _FORCE_INLINE_ void set_spawn_tick(uint64_t p_tick) { spawn_tick = p_tick; }
+    _FORCE_INLINE_ uint64_t get_seed() const { return seed; }
+    _FORCE_INLINE_ void set_seed(uint64_t p_seed) { seed = p_seed; }
+    _FORCE_INLINE_ uint32_t next_draw(uint64_t p_tick) {
+        if (draw_tick != p_tick) {
+            draw_tick = p_tick;
+            draws = 0;
+        }
+        return draws++;
+    }
+    _FORCE_INLINE_ void set_event(const Variant& p_event) { event = p_event; }
     _FORCE_INLINE_ int* get_instruction_pointer(int p_idx) { return &instruction_pointers[p_idx]; }
     _FORCE_INLINE_ float get_radius() { return frame.radius; }
     _FORCE_INLINE_ Variant* get_state() { return state; }
+    _FORCE_INLINE_ Variant* get_registers() { return registers; }
     _FORCE_INLINE_ ShotFrame* get_frame() { return &frame; }
 
+    _FORCE_INLINE_ uint32_t get_colliding_hitboxes() const { return colliding_hitboxes; }
+    _FORCE_INLINE_ uint32_t get_grazing_hitboxes() const { return grazing_hitboxes; }
+    _FORCE_INLINE_ void set_colliding_hitboxes(uint32_t p_bits) {
+        colliding_hitboxes = p_bits;
+        if (p_bits) {
+            flag(FLAG_COLLIDING);
+        } else {
+            unflag(FLAG_COLLIDING);
+        }
+    }
+    _FORCE_INLINE_ void set_grazing_hitboxes(uint32_t p_bits) {
+        grazing_hitboxes = p_bits;
+        if (p_bits) {
+            flag(FLAG_GRAZING);
+        } else {
+            unflag(FLAG_GRAZING);
+        }
+    }
+    _FORCE_INLINE_ void forget_hitbox(uint32_t p_bit) {
+        set_colliding_hitboxes(colliding_hitboxes & ~p_bit);
+        set_grazing_hitboxes(grazing_hitboxes & ~p_bit);
+    }
+
+    // Shots that only ever move in a straight line don't need to be stepped at all
+    _FORCE_INLINE_ bool can_linearize() const {
+        return !flagged(FLAG_LINEAR | FLAG_KINEMATIC | FLAG_PAUSED) && effect.is_null();
+    }
+    _FORCE_INLINE_ uint64_t get_expire_tick() const { return expire_tick; }
+    // The solved exit no longer holds once the pattern or region moves, test the shot again next tick
+    _FORCE_INLINE_ void invalidate_expire_tick() { expire_tick = 0; }
+    void linearize(uint64_t p_tick, const Transform2D& p_transform, const Rect2& p_region);
+    void update_expire_tick(uint64_t p_tick, const Transform2D& p_transform, const Rect2& p_region);
+
+    _FORCE_INLINE_ uint64_t get_wake_tick() const { return wake_tick; }
+    _FORCE_INLINE_ bool is_sleeping(int p_pass) const { return sleeps[p_pass].wake != 0; }
+    _FORCE_INLINE_ bool is_asleep(int p_pass, uint64_t p_tick) const { return sleeps[p_pass].wake > p_tick; }
+    void sleep(int p_pass, Register p_reg, const Variant& p_timer, uint64_t p_tick, Variant* p_state);
+    Variant wake(int p_pass);
+    void update_wake_tick();
+    uint32_t get_sleeping_registers() const;
+    _FORCE_INLINE_ bool is_sleeping_on_state(int p_pass) const { return sleeps[p_pass].wake && REG_SRC(sleeps[p_pass].reg) == REG_STATE; }
+    // State registers belong to a single pass, sleeps on them are told apart by the pass's state block
+    void set_state_register(Register p_reg, Variant* p_state, const Variant& p_value);
+    Variant get_state_register(Register p_reg, const Variant* p_state) const;
+
     void reset(Pattern* p_owner, int p_local_id);
     void clear();
 
@@ -117,7 +222,46 @@ public:
     void set_velocity(const Vector2& p_velocity);
     Vector2 get_velocity() const;
 
+    void set_acceleration(float p_acceleration);
+    float get_acceleration() const;
+
+    void set_angular_velocity(float p_angular_velocity);
+    float get_angular_velocity() const;
+
+    void set_min_speed(float p_min_speed);
+    float get_min_speed() const;
+
+    void set_max_speed(float p_max_speed);
+    float get_max_speed() const;
+
+    void set_homing(float p_homing);
+    float get_homing() const;
+
+    // One tick of acceleration and turning, p_target is the hitbox to home in on in the Pattern's space
+    _FORCE_INLINE_ void integrate(const Vector2* p_target) {
+        if (acceleration > 0) {
+            speed = max_speed > 0 ? MIN(speed + acceleration, max_speed) : speed + acceleration;
+        } else if (acceleration < 0) {
+            speed = MAX(speed + acceleration, min_speed);
+        }
+
+        float turn = angular_velocity;
+        if (homing > 0 && p_target) {
+            float error = direction.angle_to(*p_target - position);
+            turn += CLAMP(error, -homing, homing);
+        }
+        if (turn != 0) {
+            direction = direction.rotated(turn);
+        }
+    }
+
     Shot();
+
+private:
+    void _update_kinematic();
+    void _unlinearize();
+    void _settle_sleeps();
+    Variant _get_sleeping_timer(const Sleep& p_sleep, uint64_t p_tick) const;
 };
 
 #endif
\ No newline at end of file
@@ -2,47 +2,47 @@
 #include "shot.h"
 #include "pattern.h"
 #include "hitbox.h"
+#include "counter_rng.h"
+#include "shot_effect_format.h"
+#include "shot_effect_opcodes.h"
 
+#include "core/io/marshalls.h"
+#include "core/io/resource_loader.h"
 #include "core/method_bind_ext.gen.inc"
+#include "core/os/file_access.h"
+#include "core/os/os.h"
 
-enum {
-    CMD_MOVE,
-
-    CMD_ADD,
-    CMD_SUB,
-    CMD_MUL,
-    CMD_DIV,
-    CMD_MOD,
-
-    CMD_EQ,
-    CMD_LT,
-    CMD_LE,
-    CMD_TEST,
-
-    CMD_FIRE,
-    CMD_RESET,
-
-    CMD_TIMER,
-    CMD_YIELD,
-    CMD_END,
-    CMD_CLEAR,
-    CMD_SFX,
-
-    CMD_DEBUG
+static const char* command_names[] = {
+    "move",
+    "add",
+    "sub",
+    "mul",
+    "div",
+    "mod",
+    "sin",
+    "cos",
+    "atan2",
+    "length",
+    "normalize",
+    "lerp",
+    "aim",
+    "rand",
+    "randr",
+    "equal",
+    "less",
+    "lesseq",
+    "test",
+    "fire",
+    "reset",
+    "spawn",
+    "timer",
+    "yield",
+    "end",
+    "clear",
+    "sfx",
+    "debug"
 };
 
-#define REG_SRC(reg) (reg & 0x03)
-#define REG_IDX(reg) (reg >> 2)
-
-#define CMD(cmd) (cmd & 0xFF)
-#define ARG_A(cmd) ((cmd >> 8) & 0xFF)
-#define ARG_B(cmd) ((cmd >> 16) & 0xFF)
-#define ARG_C(cmd) ((cmd >> 24) & 0xFF)
-
-#define MAKE_CMD_A(cmd, a) ((cmd & 0xFF) | ((a & 0xFF) << 8))
-#define MAKE_CMD_AB(cmd, a, b) ((cmd & 0xFF) | ((a & 0xFF) << 8) | ((b & 0xFF) << 16))
-#define MAKE_CMD_ABC(cmd, a, b, c) ((cmd & 0xFF) | ((a & 0xFF) << 8) | ((b & 0xFF) << 16) | ((c & 0xFF) << 24))
-
 #define CURRENT (commands.size() - 1)
 
 void ShotEffect::set_register(Register p_reg, const Variant& p_value) {
@@ -56,7 +56,7 @@ void ShotEffect::set_register(Register p_reg, const Variant& p_value) {
             break;
         
         case REG_STATE:
-            current_state[p_reg >> 2] = p_value;
+            current_shot->set_state_register(p_reg, current_state, p_value);
             break;
 
         default:
@@ -75,7 +75,7 @@ Variant ShotEffect::get_register(Register p_reg) const {
             return current_pattern->get_register(p_reg);
         
         case REG_STATE:
-            return current_state[p_reg >> 2];
+            return current_shot->get_state_register(p_reg, current_state);
         
         default:
         case REG_VALUE:
@@ -123,6 +123,51 @@ int ShotEffect::mod(int p_lhs, int p_rhs, int p_to) {
     return CURRENT;
 }
 
+int ShotEffect::sin(int p_from, int p_to) {
+    commands.push_back(MAKE_CMD_AB(CMD_SIN, p_from, p_to));
+    return CURRENT;
+}
+
+int ShotEffect::cos(int p_from, int p_to) {
+    commands.push_back(MAKE_CMD_AB(CMD_COS, p_from, p_to));
+    return CURRENT;
+}
+
+int ShotEffect::atan2(int p_y, int p_x, int p_to) {
+    commands.push_back(MAKE_CMD_ABC(CMD_ATAN2, p_y, p_x, p_to));
+    return CURRENT;
+}
+
+int ShotEffect::length(int p_from, int p_to) {
+    commands.push_back(MAKE_CMD_AB(CMD_LENGTH, p_from, p_to));
+    return CURRENT;
+}
+
+int ShotEffect::normalize(int p_from, int p_to) {
+    commands.push_back(MAKE_CMD_AB(CMD_NORMALIZE, p_from, p_to));
+    return CURRENT;
+}
+
+int ShotEffect::lerp(int p_target, int p_weight, int p_to) {
+    commands.push_back(MAKE_CMD_ABC(CMD_LERP, p_target, p_weight, p_to));
+    return CURRENT;
+}
+
+int ShotEffect::aim(int p_to) {
+    commands.push_back(MAKE_CMD_A(CMD_AIM, p_to));
+    return CURRENT;
+}
+
+int ShotEffect::rand(int p_to) {
+    commands.push_back(MAKE_CMD_A(CMD_RAND, p_to));
+    return CURRENT;
+}
+
+int ShotEffect::randr(int p_min, int p_max, int p_to) {
+    commands.push_back(MAKE_CMD_ABC(CMD_RANDR, p_min, p_max, p_to));
+    return CURRENT;
+}
+
 int ShotEffect::equal(int p_lhs, int p_rhs, int p_jump) {
     commands.push_back(MAKE_CMD_ABC(CMD_EQ, p_lhs, p_rhs, p_jump));
     return CURRENT;
@@ -143,12 +188,41 @@ int ShotEffect::test(int p_test, int p_jump) {
     return CURRENT;
 }
 
+int ShotEffect::on(Event p_event) {
+    ERR_FAIL_INDEX_V(p_event, EVENT_MAX, -1);
+    ERR_FAIL_COND_V_MSG(handlers[p_event] != -1, -1, "Event already has a handler.");
+
+    // Everything added from here on belongs to the handler, until the next one starts
+    handlers[p_event] = commands.size();
+    handler_revision++;
+    if (main_size == -1) {
+        main_size = commands.size();
+    }
+    return commands.size();
+}
+
+uint32_t ShotEffect::handler_revision = 1;
+
+uint32_t ShotEffect::_build_handler_mask() const {
+    uint32_t mask = 0;
+    for (int i = 0; i != EVENT_MAX; ++i) {
+        if (handlers[i] != -1) {
+            mask |= 1 << i;
+        }
+    }
+    if (next_pass.is_valid()) {
+        mask |= next_pass->get_handler_mask();
+    }
+    return mask;
+}
+
 void ShotEffect::patch(int p_ins) {
     int cmd = CMD(commands[p_ins]);
     int a = ARG_A(commands[p_ins]);
     int b = ARG_B(commands[p_ins]);
     ERR_FAIL_COND(cmd != CMD_TEST && cmd != CMD_EQ && cmd != CMD_LT && cmd != CMD_LE);
     commands.write[p_ins] = MAKE_CMD_ABC(cmd, a, b, commands.size());
+    native_size = -1;
 }
 
 int ShotEffect::fire() {
@@ -161,6 +235,33 @@ int ShotEffect::reset() {
     return CURRENT;
 }
 
+int ShotEffect::volley(int p_count, const String& p_shape, const String& p_sprite, float p_speed, Ref<ShotEffect> p_effect, const Array& p_shape_args) {
+    // The volley's index is stored in the command itself
+    ERR_FAIL_COND_V(volleys.size() > 0xFF, -1);
+    ERR_FAIL_COND_V(p_shape_args.size() > 4, -1);
+
+    Volley config;
+    config.count = p_count;
+    config.shape = p_shape;
+    config.sprite = p_sprite;
+    config.speed = p_speed;
+    config.self = p_effect.ptr() == this;
+    if (!config.self) {
+        config.effect = p_effect;
+    }
+    for (int i = 0; i != p_shape_args.size(); ++i) {
+        config.shape_args[i] = p_shape_args[i];
+    }
+    volleys.push_back(config);
+    return volleys.size() - 1;
+}
+
+int ShotEffect::spawn(int p_volley) {
+    ERR_FAIL_INDEX_V(p_volley, volleys.size(), -1);
+    commands.push_back(MAKE_CMD_A(CMD_SPAWN, p_volley));
+    return CURRENT;
+}
+
 int ShotEffect::timer(int p_reg) {
     commands.push_back(MAKE_CMD_A(CMD_TIMER, p_reg));
     return CURRENT;
@@ -197,7 +298,12 @@ int ShotEffect::debug(int p_reg) {
 }
 
 void ShotEffect::set_next_pass(Ref<ShotEffect> p_next_pass) {
+    // A chain that loops back on itself would run forever
+    for (ShotEffect* pass = p_next_pass.ptr(); pass; pass = pass->next_pass.ptr()) {
+        ERR_FAIL_COND_MSG(pass == this, "ShotEffect can't be its own next pass.");
+    }
     next_pass = p_next_pass;
+    handler_revision++;
 }
 
 Ref<ShotEffect> ShotEffect::get_next_pass() const {
@@ -227,127 +333,677 @@ void ShotEffect::initialize_states(Variant* p_registers) const {
     }
 }
 
+// Values are encoded as Godot encodes them, resources are referred to by path
+enum {
+    KFX_VALUE,
+    KFX_RESOURCE
+};
+
+static Error _store_variant(FileAccess* p_file, const Variant& p_value) {
+    if (p_value.get_type() == Variant::OBJECT) {
+        RES resource = p_value;
+        String path = resource.is_valid() ? resource->get_path() : String();
+        ERR_FAIL_COND_V_MSG(resource.is_valid() && (path.empty() || path.find("::") != -1), ERR_INVALID_DATA, "ShotEffects can only refer to resources saved to their own files.");
+        p_file->store_8(KFX_RESOURCE);
+        p_file->store_pascal_string(path);
+        return OK;
+    }
+
+    int length = 0;
+    Error err = encode_variant(p_value, NULL, length);
+    ERR_FAIL_COND_V(err != OK, err);
+    Vector<uint8_t> buffer;
+    buffer.resize(length);
+    encode_variant(p_value, buffer.ptrw(), length);
+
+    p_file->store_8(KFX_VALUE);
+    p_file->store_32(length);
+    p_file->store_buffer(buffer.ptr(), length);
+    return OK;
+}
+
+bool ShotEffect::_is_valid_operand(int p_kind, uint8_t p_operand) const {
+    switch (p_kind) {
+        case OPERAND_READ:
+        case OPERAND_WRITE:
+            switch (REG_SRC(p_operand)) {
+                case REG_VALUE: return p_kind == OPERAND_READ && REG_IDX(p_operand) < constants.size();
+                case REG_STATE: return REG_IDX(p_operand) < states.size();
+                case REG_SHOT: return REG_IDX(p_operand) <= REG_IDX(Shot::EVENT);
+                default: return REG_IDX(p_operand) <= REG_IDX(Pattern::FIRE_SPEED_JITTER);
+            }
+
+        case OPERAND_JUMP: return p_operand <= commands.size();
+        case OPERAND_VOLLEY: return p_operand < volleys.size();
+        default: return true;
+    }
+}
+
+Error ShotEffect::_validate_program() const {
+    for (int i = 0; i != commands.size(); ++i) {
+        Command cmd = commands[i];
+        ERR_FAIL_COND_V(CMD(cmd) > CMD_DEBUG, ERR_FILE_CORRUPT);
+
+        const uint8_t* operands = command_operands[CMD(cmd)];
+        ERR_FAIL_COND_V_MSG(!_is_valid_operand(operands[0], ARG_A(cmd)), ERR_FILE_CORRUPT, "Command " + itos(i) + " has an operand out of range.");
+        ERR_FAIL_COND_V_MSG(!_is_valid_operand(operands[1], ARG_B(cmd)), ERR_FILE_CORRUPT, "Command " + itos(i) + " has an operand out of range.");
+        ERR_FAIL_COND_V_MSG(!_is_valid_operand(operands[2], ARG_C(cmd)), ERR_FILE_CORRUPT, "Command " + itos(i) + " has an operand out of range.");
+    }
+
+    // Handlers come after the per-tick program, which only exists once there's a handler
+    for (int i = 0; i != EVENT_MAX; ++i) {
+        if (handlers[i] != -1) {
+            ERR_FAIL_COND_V(main_size == -1 || main_size > handlers[i], ERR_FILE_CORRUPT);
+        }
+    }
+    return OK;
+}
+
+Error ShotEffect::_validate_chain() const {
+    // Every pass checks out on its own, but a shot only has room for so many passes and states between them
+    int pass_count = 0;
+    int state_count = 0;
+    for (const ShotEffect* pass = this; pass; pass = pass->next_pass.ptr()) {
+        pass_count++;
+        state_count += pass->states.size();
+        ERR_FAIL_COND_V_MSG(pass_count > MAX_SHOT_EFFECTS, ERR_FILE_CORRUPT, "ShotEffect has more than " + itos(MAX_SHOT_EFFECTS) + " passes.");
+    }
+    ERR_FAIL_COND_V_MSG(state_count > STATE_REGISTERS, ERR_FILE_CORRUPT, "ShotEffect passes have more than " + itos(STATE_REGISTERS) + " states between them.");
+    return OK;
+}
+
+static Error _load_variant(FileAccess* p_file, Variant& r_value) {
+    if (p_file->get_8() == KFX_RESOURCE) {
+        String path = p_file->get_pascal_string();
+        if (path.empty()) {
+            r_value = Variant();
+            return OK;
+        }
+        // A pass or volley effect that can't be loaded takes the whole effect down with it
+        Error err = OK;
+        RES resource = ResourceLoader::load(path, "", false, &err);
+        ERR_FAIL_COND_V_MSG(resource.is_null(), err == OK ? ERR_FILE_MISSING_DEPENDENCIES : err, "Cannot load '" + path + "'.");
+        r_value = resource;
+        return OK;
+    }
+
+    int length = p_file->get_32();
+    ERR_FAIL_COND_V(length < 0 || length > (int)p_file->get_len(), ERR_FILE_CORRUPT);
+    Vector<uint8_t> buffer;
+    buffer.resize(length);
+    p_file->get_buffer(buffer.ptrw(), length);
+    return decode_variant(r_value, buffer.ptr(), length);
+}
+
+Error ShotEffect::save_program(FileAccess* p_file) const {
+    p_file->store_buffer((const uint8_t*)"KFX", 4);
+    p_file->store_32(KFX_VERSION);
+
+    // Every platform Godot runs on is little endian, same as the file, so commands are stored as they are
+    p_file->store_32(commands.size());
+    p_file->store_buffer((const uint8_t*)commands.ptr(), commands.size() * sizeof(Command));
+
+    for (int i = 0; i != EVENT_MAX; ++i) {
+        p_file->store_32(handlers[i]);
+    }
+    p_file->store_32(main_size);
+
+    Error err = OK;
+    p_file->store_32(constants.size());
+    for (int i = 0; i != constants.size() && err == OK; ++i) {
+        err = _store_variant(p_file, constants[i]);
+    }
+    p_file->store_32(states.size());
+    for (int i = 0; i != states.size() && err == OK; ++i) {
+        err = _store_variant(p_file, states[i]);
+    }
+    ERR_FAIL_COND_V(err != OK, err);
+
+    p_file->store_32(volleys.size());
+    for (int i = 0; i != volleys.size(); ++i) {
+        const Volley& config = volleys[i];
+        p_file->store_32(config.count);
+        p_file->store_pascal_string(config.shape);
+        p_file->store_pascal_string(config.sprite);
+        p_file->store_float(config.speed);
+        p_file->store_8(config.self);
+        err = _store_variant(p_file, config.effect);
+        for (int j = 0; j != 4 && err == OK; ++j) {
+            err = _store_variant(p_file, config.shape_args[j]);
+        }
+        ERR_FAIL_COND_V(err != OK, err);
+    }
+
+    return _store_variant(p_file, next_pass);
+}
+
+Error ShotEffect::load_program(FileAccess* p_file) {
+    Error err = _load_program(p_file);
+    if (err == OK) {
+        err = _validate_program();
+    }
+    if (err == OK) {
+        err = _validate_chain();
+    }
+
+    // Whatever fails to load or validate is dropped, a corrupt program must never get to run
+    if (err != OK) {
+        commands.clear();
+        for (int i = 0; i != EVENT_MAX; ++i) {
+            handlers[i] = -1;
+        }
+        main_size = -1;
+        states.clear();
+        next_pass = Ref<ShotEffect>();
+    }
+
+    instruction_counts.clear();
+    native_size = -1;
+    handler_revision++;
+    return err;
+}
+
+Error ShotEffect::_load_program(FileAccess* p_file) {
+    uint8_t magic[4];
+    p_file->get_buffer(magic, 4);
+    ERR_FAIL_COND_V_MSG(magic[0] != 'K' || magic[1] != 'F' || magic[2] != 'X' || magic[3] != 0, ERR_FILE_UNRECOGNIZED, "Not a ShotEffect file.");
+    uint32_t version = p_file->get_32();
+    ERR_FAIL_COND_V_MSG(version > KFX_VERSION, ERR_FILE_UNRECOGNIZED, "ShotEffect file was saved by a newer version of kdanmaku.");
+
+    int command_count = p_file->get_32();
+    ERR_FAIL_COND_V(command_count < 0 || command_count * sizeof(Command) > p_file->get_len(), ERR_FILE_CORRUPT);
+    commands.resize(command_count);
+    p_file->get_buffer((uint8_t*)commands.ptrw(), command_count * sizeof(Command));
+
+    for (int i = 0; i != EVENT_MAX; ++i) {
+        handlers[i] = (int32_t)p_file->get_32();
+        ERR_FAIL_COND_V(handlers[i] < -1 || handlers[i] > command_count, ERR_FILE_CORRUPT);
+    }
+    main_size = (int32_t)p_file->get_32();
+    ERR_FAIL_COND_V(main_size < -1 || main_size > command_count, ERR_FILE_CORRUPT);
+
+    Error err = OK;
+    int constant_count = p_file->get_32();
+    ERR_FAIL_COND_V(constant_count < 0 || constant_count > 0x40, ERR_FILE_CORRUPT);
+    constants.resize(constant_count);
+    for (int i = 0; i != constant_count && err == OK; ++i) {
+        err = _load_variant(p_file, constants.write[i]);
+    }
+    int state_count = p_file->get_32();
+    ERR_FAIL_COND_V(state_count < 0 || state_count > STATE_REGISTERS, ERR_FILE_CORRUPT);
+    states.resize(state_count);
+    for (int i = 0; i != state_count && err == OK; ++i) {
+        err = _load_variant(p_file, states.write[i]);
+    }
+    ERR_FAIL_COND_V(err != OK, err);
+
+    int volley_count = p_file->get_32();
+    ERR_FAIL_COND_V(volley_count < 0 || volley_count > 0x100, ERR_FILE_CORRUPT);
+    volleys.resize(volley_count);
+    for (int i = 0; i != volley_count; ++i) {
+        Volley& config = volleys.write[i];
+        config.count = p_file->get_32();
+        config.shape = p_file->get_pascal_string();
+        config.sprite = p_file->get_pascal_string();
+        config.speed = p_file->get_float();
+        config.self = version >= 2 && p_file->get_8();
+
+        Variant effect;
+        err = _load_variant(p_file, effect);
+        config.effect = Ref<ShotEffect>(effect);
+        for (int j = 0; j != 4 && err == OK; ++j) {
+            err = _load_variant(p_file, config.shape_args[j]);
+        }
+        ERR_FAIL_COND_V(err != OK, err);
+    }
+
+    Variant pass;
+    err = _load_variant(p_file, pass);
+    next_pass = Ref<ShotEffect>(pass);
+    ERR_FAIL_COND_V(p_file->get_error() != OK && p_file->get_error() != ERR_FILE_EOF, ERR_FILE_CORRUPT);
+    return err;
+}
+
 void ShotEffect::execute_tick(Shot* p_shot, int p_id, Variant* p_state) {
     current_shot = p_shot;
     current_state = p_state;
     current_pattern = p_shot->get_pattern();
 
     int* ins = current_shot->get_instruction_pointer(p_id);
-    if (*ins == -1) {
+    if (*ins == -1 || current_shot->is_asleep(p_id, current_tick)) {
+        return;
+    }
+
+    // An effect made of nothing but handlers has nothing to run every tick
+    int end = main_size == -1 ? commands.size() : main_size;
+    if (end == 0) {
+        *ins = -1;
         return;
     }
 
-    while (*ins < commands.size()) {
-Begin:
-        Command cmd = commands[*ins];
-
-        switch (CMD(cmd)) {
-            case CMD_MOVE:
-                set_register(ARG_B(cmd), get_register(ARG_A(cmd)));
-                break;
-            
-            case CMD_ADD:
-                set_register(ARG_C(cmd), Variant::evaluate(Variant::OP_ADD, get_register(ARG_A(cmd)), get_register(ARG_B(cmd))));
-                break;
-            
-            case CMD_SUB:
-                set_register(ARG_C(cmd), Variant::evaluate(Variant::OP_SUBTRACT, get_register(ARG_A(cmd)), get_register(ARG_B(cmd))));
-                break;
-            
-            case CMD_MUL:
-                set_register(ARG_C(cmd), Variant::evaluate(Variant::OP_MULTIPLY, get_register(ARG_A(cmd)), get_register(ARG_B(cmd))));
-                break;
-            
-            case CMD_DIV:
-                set_register(ARG_C(cmd), Variant::evaluate(Variant::OP_DIVIDE, get_register(ARG_A(cmd)), get_register(ARG_B(cmd))));
-                break;
-            
-            case CMD_MOD:
-                set_register(ARG_C(cmd), Variant::evaluate(Variant::OP_MODULE, get_register(ARG_A(cmd)), get_register(ARG_B(cmd))));
-                break;
-            
-            case CMD_EQ:
-                if (!Variant::evaluate(Variant::OP_EQUAL, get_register(ARG_A(cmd)), get_register(ARG_B(cmd)))) {
-                    *ins = ARG_C(cmd);
-                    goto Begin;
+    handling = false;
+    _run(ins, end, p_id);
+}
+
+void ShotEffect::_run(int* p_ins, int p_end, int p_id) {
+    // Native programs can be turned off as a whole, to compare them against the interpreter
+    NativeProgram program = native_enabled ? _get_native() : NULL;
+#ifdef KDANMAKU_PROFILING
+    // Opcodes are only counted by the interpreter
+    if (unlikely(profiling)) {
+        program = NULL;
+    }
+#endif
+    // Native programs read states directly, so a handler running while its pass sleeps on one is interpreted
+    if (program && handling && current_shot->is_sleeping_on_state(p_id)) {
+        program = NULL;
+    }
+    if (program) {
+        program(this, p_ins, p_end, p_id);
+    } else {
+        _interpret(p_ins, p_end, p_id);
+    }
+}
+
+ShotEffect::Step ShotEffect::_step(Command p_cmd, int* p_ins, int p_end, int p_id) {
+    switch (CMD(p_cmd)) {
+        case CMD_MOVE:
+            set_register(ARG_B(p_cmd), get_register(ARG_A(p_cmd)));
+            break;
+        
+        case CMD_ADD:
+            set_register(ARG_C(p_cmd), Variant::evaluate(Variant::OP_ADD, get_register(ARG_A(p_cmd)), get_register(ARG_B(p_cmd))));
+            break;
+        
+        case CMD_SUB:
+            set_register(ARG_C(p_cmd), Variant::evaluate(Variant::OP_SUBTRACT, get_register(ARG_A(p_cmd)), get_register(ARG_B(p_cmd))));
+            break;
+        
+        case CMD_MUL:
+            set_register(ARG_C(p_cmd), Variant::evaluate(Variant::OP_MULTIPLY, get_register(ARG_A(p_cmd)), get_register(ARG_B(p_cmd))));
+            break;
+        
+        case CMD_DIV:
+            set_register(ARG_C(p_cmd), Variant::evaluate(Variant::OP_DIVIDE, get_register(ARG_A(p_cmd)), get_register(ARG_B(p_cmd))));
+            break;
+        
+        case CMD_MOD:
+            set_register(ARG_C(p_cmd), Variant::evaluate(Variant::OP_MODULE, get_register(ARG_A(p_cmd)), get_register(ARG_B(p_cmd))));
+            break;
+        
+        case CMD_SIN:
+            set_register(ARG_B(p_cmd), Math::sin((real_t)get_register(ARG_A(p_cmd))));
+            break;
+        
+        case CMD_COS:
+            set_register(ARG_B(p_cmd), Math::cos((real_t)get_register(ARG_A(p_cmd))));
+            break;
+        
+        case CMD_ATAN2:
+            set_register(ARG_C(p_cmd), Math::atan2((real_t)get_register(ARG_A(p_cmd)), (real_t)get_register(ARG_B(p_cmd))));
+            break;
+        
+        case CMD_LENGTH:
+            {
+                Variant value = get_register(ARG_A(p_cmd));
+                if (value.get_type() == Variant::VECTOR2) {
+                    set_register(ARG_B(p_cmd), ((Vector2)value).length());
+                } else {
+                    set_register(ARG_B(p_cmd), Math::abs((real_t)value));
                 }
-                break;
-            
-            case CMD_LT:
-                if (!Variant::evaluate(Variant::OP_LESS, get_register(ARG_A(cmd)), get_register(ARG_B(cmd)))) {
-                    *ins = ARG_C(cmd);
-                    goto Begin;
+            }
+            break;
+        
+        case CMD_NORMALIZE:
+            {
+                Variant value = get_register(ARG_A(p_cmd));
+                if (value.get_type() == Variant::VECTOR2) {
+                    set_register(ARG_B(p_cmd), ((Vector2)value).normalized());
+                } else {
+                    // Zero has no direction, same as a zero vector
+                    real_t number = value;
+                    set_register(ARG_B(p_cmd), number == 0 ? 0.0 : SGN(number));
                 }
-                break;
-            
-            case CMD_LE:
-                if (!Variant::evaluate(Variant::OP_LESS_EQUAL, get_register(ARG_A(cmd)), get_register(ARG_B(cmd)))) {
-                    *ins = ARG_C(cmd);
-                    goto Begin;
+            }
+            break;
+        
+        case CMD_LERP:
+            {
+                // Eases the destination toward the target, works on anything Variant can interpolate
+                Variant result;
+                Variant::interpolate(get_register(ARG_C(p_cmd)), get_register(ARG_A(p_cmd)), get_register(ARG_B(p_cmd)), result);
+                set_register(ARG_C(p_cmd), result);
+            }
+            break;
+        
+        case CMD_AIM:
+            {
+                // Leaves the register alone when there's nothing to aim at
+                real_t angle;
+                if (_aim(angle)) {
+                    set_register(ARG_A(p_cmd), angle);
                 }
-                break;
-                        
-            case CMD_TEST:
-                if (!get_register(ARG_A(cmd))) {
-                    *ins = ARG_C(cmd);
-                    goto Begin;
+            }
+            break;
+        
+        case CMD_RAND:
+            set_register(ARG_A(p_cmd), CounterRNG::unit(_random_bits(p_id, *p_ins)));
+            break;
+        
+        case CMD_RANDR:
+            {
+                real_t min = get_register(ARG_A(p_cmd));
+                real_t max = get_register(ARG_B(p_cmd));
+                set_register(ARG_C(p_cmd), min + (max - min) * CounterRNG::unit(_random_bits(p_id, *p_ins)));
+            }
+            break;
+        
+        case CMD_EQ:
+            if (!Variant::evaluate(Variant::OP_EQUAL, get_register(ARG_A(p_cmd)), get_register(ARG_B(p_cmd)))) {
+                *p_ins = ARG_C(p_cmd);
+                return STEP_JUMP;
+            }
+            break;
+        
+        case CMD_LT:
+            if (!Variant::evaluate(Variant::OP_LESS, get_register(ARG_A(p_cmd)), get_register(ARG_B(p_cmd)))) {
+                *p_ins = ARG_C(p_cmd);
+                return STEP_JUMP;
+            }
+            break;
+        
+        case CMD_LE:
+            if (!Variant::evaluate(Variant::OP_LESS_EQUAL, get_register(ARG_A(p_cmd)), get_register(ARG_B(p_cmd)))) {
+                *p_ins = ARG_C(p_cmd);
+                return STEP_JUMP;
+            }
+            break;
+                    
+        case CMD_TEST:
+            if (!get_register(ARG_A(p_cmd))) {
+                *p_ins = ARG_C(p_cmd);
+                return STEP_JUMP;
+            }
+            break;
+        
+        case CMD_FIRE:
+            current_shot->get_pattern()->fire();
+            break;
+        
+        case CMD_RESET:
+            current_shot->get_pattern()->reset();
+            break;
+        
+        case CMD_SPAWN:
+            current_pattern->queue_spawn(this, ARG_A(p_cmd), current_shot);
+            break;
+        
+        case CMD_TIMER:
+            {
+                // Handlers run to completion within the event, waiting on a timer just ends them
+                if (handling) {
+                    return STEP_STOP;
+                }
+
+                Register reg = ARG_A(p_cmd);
+                if (current_shot->is_sleeping(p_id)) {
+                    // Slept through the countdown, leave the register where counting down would have
+                    set_register(reg, current_shot->wake(p_id));
+                    break;
                 }
-                break;
-            
-            case CMD_FIRE:
-                current_shot->get_pattern()->fire();
-                break;
-            
-            case CMD_RESET:
-                current_shot->get_pattern()->reset();
-                break;
-            
-            case CMD_TIMER:
-                {
-                    Variant timer = get_register(ARG_A(cmd));
-                    if (Variant::evaluate(Variant::OP_GREATER, timer, 0)) {
-                        set_register(ARG_A(cmd), Variant::evaluate(Variant::OP_SUBTRACT, timer, 1));
-                        return;
+
+                Variant timer = get_register(reg);
+                if (Variant::evaluate(Variant::OP_GREATER, timer, 0)) {
+                    if (_can_sleep_on(reg, timer)) {
+                        current_shot->sleep(p_id, reg, timer, current_tick, current_state);
+                    } else {
+                        set_register(reg, Variant::evaluate(Variant::OP_SUBTRACT, timer, 1));
                     }
+                    return STEP_STOP;
                 }
-                break;
-            
-            case CMD_YIELD:
-                *ins = (*ins + 1) % commands.size();
-                return;
-            
-            case CMD_END:
-                *ins = -1;
-                return;
-            
-            case CMD_CLEAR:
-                current_shot->clear();
-                return;
-            
-            case CMD_SFX:
-                current_shot->get_pattern()->play_sfx(get_register(ARG_A(cmd)));
-                break;
-            
-            case CMD_DEBUG:
-                print_line(get_register(ARG_A(cmd)));
-                break;
+            }
+            break;
+        
+        case CMD_YIELD:
+            *p_ins = (*p_ins + 1) % p_end;
+            return STEP_STOP;
+        
+        case CMD_END:
+            *p_ins = -1;
+            return STEP_STOP;
+        
+        case CMD_CLEAR:
+            current_shot->clear();
+            return STEP_STOP;
+        
+        case CMD_SFX:
+            current_shot->get_pattern()->play_sfx(get_register(ARG_A(p_cmd)));
+            break;
+        
+        case CMD_DEBUG:
+            print_line(get_register(ARG_A(p_cmd)));
+            break;
+    }
+
+    return STEP_NEXT;
+}
+
+ShotEffect::Step ShotEffect::_run_command(int* p_ins, int p_end, int p_id) {
+    return _step(commands[*p_ins], p_ins, p_end, p_id);
+}
+
+void ShotEffect::_interpret(int* p_ins, int p_end, int p_id) {
+#ifdef KDANMAKU_PROFILING
+    uint64_t* counts = NULL;
+    if (unlikely(profiling)) {
+        if (instruction_counts.size() != commands.size()) {
+            instruction_counts.resize(commands.size());
+        }
+        counts = instruction_counts.ptrw();
+    }
+#endif
+
+    while (*p_ins < p_end) {
+#ifdef KDANMAKU_PROFILING
+        if (unlikely(counts)) {
+            counts[*p_ins]++;
         }
+#endif
 
-        *ins = *ins + 1;
+        Step step = _step(commands[*p_ins], p_ins, p_end, p_id);
+        if (step == STEP_STOP) {
+            return;
+        }
+        if (step == STEP_NEXT) {
+            *p_ins = *p_ins + 1;
+        }
     }
 
-    *ins = *ins % commands.size();
+    *p_ins = *p_ins % p_end;
 }
 
 void ShotEffect::execute(Shot* p_shot, int p_id, Variant* p_state) {
+#ifdef KDANMAKU_PROFILING
+    if (unlikely(profiling)) {
+        // Most executions take well under a microsecond, but the rounding error averages out over many calls
+        uint64_t begin = OS::get_singleton()->get_ticks_usec();
+        execute_tick(p_shot, p_id, p_state);
+        execution_time += OS::get_singleton()->get_ticks_usec() - begin;
+        executions++;
+        if (!profile_item.in_list()) {
+            profiled_effects.add(&profile_item);
+        }
+    } else {
+        execute_tick(p_shot, p_id, p_state);
+    }
+#else
     execute_tick(p_shot, p_id, p_state);
+#endif
     if (next_pass.is_valid()) {
         next_pass->execute(p_shot, p_id + 1, p_state + states.size());
     }
 }
 
 void ShotEffect::execute(Shot* p_shot) {
+    // Every pass reads the tick from the root effect, which is the one Patterns call
+    uint64_t tick = p_shot->get_danmaku()->get_tick();
+    for (ShotEffect* pass = this; pass; pass = pass->next_pass.ptr()) {
+        pass->current_tick = tick;
+    }
+
     execute(p_shot, 0, p_shot->get_state());
+    p_shot->update_wake_tick();
+}
+
+uint64_t ShotEffect::_random_bits(int p_id, int p_ins) {
+    // Every draw in a tick gets its own counter, so rerunning a tick draws the same numbers in the same order
+    uint64_t key = CounterRNG::hash(current_shot->get_seed(), current_tick);
+    key = CounterRNG::hash(key, ((uint64_t)p_id << 32) | (uint32_t)p_ins);
+    return CounterRNG::hash(key, current_shot->next_draw(current_tick));
+}
+
+bool ShotEffect::_aim(real_t& r_angle) const {
+    Vector2 position = current_shot->get_global_position();
+    Hitbox* hitbox = current_shot->get_danmaku()->get_nearest_hitbox(position, current_pattern->get_hitbox_mask());
+    if (!hitbox) {
+        return false;
+    }
+    r_angle = (hitbox->get_global_position() - position).angle();
+    return true;
+}
+
+void ShotEffect::handle(Shot* p_shot, Event p_event, const Variant& p_data) {
+    uint64_t tick = p_shot->get_danmaku()->get_tick();
+    p_shot->set_event(p_data);
+
+    int id = 0;
+    Variant* state = p_shot->get_state();
+    for (ShotEffect* pass = this; pass; pass = pass->next_pass.ptr()) {
+        int start = pass->handlers[p_event];
+        if (start != -1) {
+            // A handler ends where the next one after it starts
+            int end = pass->commands.size();
+            for (int i = 0; i != EVENT_MAX; ++i) {
+                if (pass->handlers[i] > start && pass->handlers[i] < end) {
+                    end = pass->handlers[i];
+                }
+            }
+
+            pass->current_shot = p_shot;
+            pass->current_state = state;
+            pass->current_pattern = p_shot->get_pattern();
+            pass->current_tick = tick;
+            pass->handling = true;
+            pass->_run(&start, end, id);
+            pass->handling = false;
+        }
+        state += pass->states.size();
+        id++;
+    }
+}
+
+bool ShotEffect::_can_sleep_on(Register p_reg, const Variant& p_timer) const {
+    // Pattern registers are shared between shots, so only per-shot timers can be slept on
+    if (p_timer.get_type() != Variant::INT && p_timer.get_type() != Variant::REAL) {
+        return false;
+    }
+    return REG_SRC(p_reg) == REG_STATE || (REG_SRC(p_reg) == REG_SHOT && REG_IDX(p_reg) < SHOT_REGISTERS);
+}
+
+bool ShotEffect::profiling = false;
+SelfList<ShotEffect>::List ShotEffect::profiled_effects;
+
+void ShotEffect::set_profiling(bool p_profiling) {
+#ifdef KDANMAKU_PROFILING
+    profiling = p_profiling;
+#else
+    ERR_FAIL_COND_MSG(p_profiling, "Effect profiling is unavailable, kdanmaku was built without profiling.");
+#endif
+}
+
+bool ShotEffect::is_profiling() {
+    return profiling;
+}
+
+void ShotEffect::reset_profile() {
+    while (profiled_effects.first()) {
+        ShotEffect* effect = profiled_effects.first()->self();
+        effect->instruction_counts.clear();
+        effect->executions = 0;
+        effect->execution_time = 0;
+        profiled_effects.remove(&effect->profile_item);
+    }
+}
+
+Array ShotEffect::get_profile() {
+    Array profile;
+    for (SelfList<ShotEffect>* E = profiled_effects.first(); E; E = E->next()) {
+        ShotEffect* effect = E->self();
+
+        String name = effect->get_name();
+        if (name.empty()) {
+            name = effect->get_path().empty() ? "ShotEffect:" + itos(effect->get_instance_id()) : effect->get_path();
+        }
+
+        Array opcodes;
+        Array counts;
+        for (int i = 0; i != effect->instruction_counts.size(); ++i) {
+            opcodes.push_back(command_names[CMD(effect->commands[i])]);
+            counts.push_back(effect->instruction_counts[i]);
+        }
+
+        Dictionary row;
+        row["effect"] = name;
+        row["executions"] = effect->executions;
+        row["time_usec"] = effect->execution_time;
+        row["usec_per_execution"] = effect->executions ? (double)effect->execution_time / effect->executions : 0.0;
+        row["opcodes"] = opcodes;
+        row["instruction_counts"] = counts;
+        profile.push_back(row);
+    }
+    return profile;
+}
+
+String ShotEffect::get_profile_table() {
+    Array profile = get_profile();
+    String table = "";
+
+    for (int i = 0; i != profile.size(); ++i) {
+        Dictionary row = profile[i];
+        table += String(row["effect"]) + ": " + itos(row["executions"]) + " executions, " + itos(row["time_usec"]) + "us (" + rtos(row["usec_per_execution"]) + "us each)\n";
+
+        Array opcodes = row["opcodes"];
+        Array counts = row["instruction_counts"];
+        for (int j = 0; j != opcodes.size(); ++j) {
+            table += "    " + itos(j).lpad(4) + "  " + String(opcodes[j]).rpad(8) + "  " + itos(counts[j]) + "\n";
+        }
+    }
+    return table;
+}
+
+Error ShotEffect::export_profile(const String& p_path) {
+    Error err;
+    FileAccess* file = FileAccess::open(p_path, FileAccess::WRITE, &err);
+    ERR_FAIL_COND_V_MSG(err != OK, err, "Cannot open effect profile file '" + p_path + "'.");
+
+    // One line per instruction, with the owning effect's totals repeated so the file sorts and pivots easily
+    file->store_line("effect,executions,time_usec,instruction,opcode,count");
+
+    Array profile = get_profile();
+    for (int i = 0; i != profile.size(); ++i) {
+        Dictionary row = profile[i];
+        Array opcodes = row["opcodes"];
+        Array counts = row["instruction_counts"];
+
+        String prefix = "\"" + String(row["effect"]).replace("\"", "\"\"") + "\"," + itos(row["executions"]) + "," + itos(row["time_usec"]) + ",";
+        for (int j = 0; j != opcodes.size(); ++j) {
+            file->store_line(prefix + itos(j) + "," + String(opcodes[j]) + "," + itos(counts[j]));
+        }
+    }
+
+    file->close();
+    memdelete(file);
+    return OK;
 }
 
 void ShotEffect::_bind_methods() {
@@ -362,6 +1018,17 @@ void ShotEffect::_bind_methods() {
     ClassDB::bind_method(D_METHOD("div", "lhs", "rhs", "to"), &ShotEffect::div);
     ClassDB::bind_method(D_METHOD("mod", "lhs", "rhs", "to"), &ShotEffect::mod);
 
+    ClassDB::bind_method(D_METHOD("sin", "from", "to"), &ShotEffect::sin);
+    ClassDB::bind_method(D_METHOD("cos", "from", "to"), &ShotEffect::cos);
+    ClassDB::bind_method(D_METHOD("atan2", "y", "x", "to"), &ShotEffect::atan2);
+    ClassDB::bind_method(D_METHOD("length", "from", "to"), &ShotEffect::length);
+    ClassDB::bind_method(D_METHOD("normalize", "from", "to"), &ShotEffect::normalize);
+    ClassDB::bind_method(D_METHOD("lerp", "target", "weight", "to"), &ShotEffect::lerp);
+    ClassDB::bind_method(D_METHOD("aim", "to"), &ShotEffect::aim);
+
+    ClassDB::bind_method(D_METHOD("rand", "to"), &ShotEffect::rand);
+    ClassDB::bind_method(D_METHOD("randr", "min", "max", "to"), &ShotEffect::randr);
+
     ClassDB::bind_method(D_METHOD("equal", "lhs", "rhs", "jump"), &ShotEffect::equal);
     ClassDB::bind_method(D_METHOD("less", "lhs", "rhs", "jump"), &ShotEffect::less);
     ClassDB::bind_method(D_METHOD("lesseq", "lhs", "rhs", "jump"), &ShotEffect::lesseq);
@@ -369,9 +1036,14 @@ void ShotEffect::_bind_methods() {
 
     ClassDB::bind_method(D_METHOD("patch", "ins"), &ShotEffect::patch);
 
+    ClassDB::bind_method(D_METHOD("on", "event"), &ShotEffect::on);
+
     ClassDB::bind_method(D_METHOD("fire"), &ShotEffect::fire);
     ClassDB::bind_method(D_METHOD("reset"), &ShotEffect::reset);
 
+    ClassDB::bind_method(D_METHOD("volley", "count", "shape", "sprite", "speed", "effect", "shape_args"), &ShotEffect::volley, DEFVAL(Variant()), DEFVAL(Array()));
+    ClassDB::bind_method(D_METHOD("spawn", "volley"), &ShotEffect::spawn);
+
     ClassDB::bind_method(D_METHOD("timer", "reg"), &ShotEffect::timer);
     ClassDB::bind_method(D_METHOD("yield"), &ShotEffect::yield);
     ClassDB::bind_method(D_METHOD("end"), &ShotEffect::end);
@@ -384,19 +1056,51 @@ void ShotEffect::_bind_methods() {
 
     ClassDB::bind_method(D_METHOD("state", "default"), &ShotEffect::state);
 
+    ClassDB::bind_method(D_METHOD("get_program_hash"), &ShotEffect::get_program_hash);
+    ClassDB::bind_method(D_METHOD("has_native"), &ShotEffect::has_native);
+    ClassDB::bind_method(D_METHOD("export_native", "dir"), &ShotEffect::export_native);
+
     ClassDB::bind_method(D_METHOD("set_next_pass", "next_pass"), &ShotEffect::set_next_pass);
     ClassDB::bind_method(D_METHOD("get_next_pass"), &ShotEffect::get_next_pass);
     ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "next_pass", PROPERTY_HINT_RESOURCE_TYPE, "ShotEffect"), "set_next_pass", "get_next_pass");
+
+    BIND_ENUM_CONSTANT(EVENT_HIT);
+    BIND_ENUM_CONSTANT(EVENT_GRAZE);
+    BIND_ENUM_CONSTANT(EVENT_DESPAWN);
+    BIND_ENUM_CONSTANT(EVENT_WALL);
 }
 
-ShotEffect::ShotEffect() {
+ShotEffect::ShotEffect() :
+        profile_item(this) {
+    executions = 0;
+    execution_time = 0;
+
     current_shot = nullptr;
     current_pattern = nullptr;
     current_state = nullptr;
+    current_tick = 0;
 
     commands = Vector<Command>();
     constants = Vector<Variant>();
     states = Vector<Variant>();
+    volleys = Vector<Volley>();
+
+    for (int i = 0; i != EVENT_MAX; ++i) {
+        handlers[i] = -1;
+    }
+    main_size = -1;
+    handling = false;
+    handler_mask = 0;
+    handler_mask_revision = 0;
+
+    native = NULL;
+    native_size = -1;
+    jit_code = NULL;
+    jit_size = 0;
 
     next_pass = Ref<ShotEffect>();
+}
+
+ShotEffect::~ShotEffect() {
+    _release_jit();
 }
\ No newline at end of file
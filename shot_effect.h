@@ -2,12 +2,16 @@
 // *:･ﾟ✧ shot_effect.hpp *:･ﾟ✧
 // 
 // A ShotEffect is an object containing a list of Commands that execute on a Shot each frame.
+// Commands added after on() make up a handler instead, which only runs when its event happens
+// to the Shot, with whatever the event was about in the Shot's EVENT register.
 // ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
 
 #ifndef SHOT_EFFECT_H
 #define SHOT_EFFECT_H
 
+#include "core/hash_map.h"
 #include "core/resource.h"
+#include "core/self_list.h"
 
 #define STATUS_CONTINUE 0
 #define STATUS_YIELD 1
@@ -23,6 +27,7 @@ enum {
 
 class Shot;
 class Pattern;
+class FileAccess;
 
 typedef uint32_t Command;
 typedef uint8_t Register;
@@ -30,16 +35,79 @@ typedef uint8_t Register;
 class ShotEffect : public Resource {
     GDCLASS(ShotEffect, Resource);
 
+public:
+    enum Event {
+        EVENT_HIT,
+        EVENT_GRAZE,
+        EVENT_DESPAWN,
+        EVENT_WALL,
+        EVENT_MAX
+    };
+
+    // What running a single command did, natively compiled programs fall back on it for most opcodes
+    enum Step {
+        STEP_NEXT,
+        STEP_JUMP,
+        STEP_STOP
+    };
+
+    typedef void (*NativeProgram)(ShotEffect* p_effect, int* p_ins, int p_end, int p_id);
+
+    // Fired from a shot's position and rotation by the spawn opcode, at the end of the tick
+    struct Volley {
+        int count;
+        String shape;
+        String sprite;
+        float speed;
+        Ref<ShotEffect> effect;
+        Variant shape_args[4];
+
+        // Shots run the effect that spawned them, a flag rather than a Ref so it never owns itself
+        bool self;
+    };
+
+private:
     Shot* current_shot;
     Pattern* current_pattern;
     Variant* current_state;
+    uint64_t current_tick;
     
     Vector<Command> commands;
     Vector<Variant> constants;
     Vector<Variant> states;
+    Vector<Volley> volleys;
+
+    // Where each event's handler starts, and where the per-tick program ends
+    int handlers[EVENT_MAX];
+    int main_size;
+    bool handling;
+
+    // The mask covers every pass, so it's rebuilt whenever any effect's handlers or passes change
+    static uint32_t handler_revision;
+    mutable uint32_t handler_mask;
+    mutable uint32_t handler_mask_revision;
+
+    // Ahead of time compiled programs, looked up by the hash of the program they were compiled from
+    static HashMap<uint64_t, NativeProgram> native_programs;
+    static bool native_enabled;
+    NativeProgram native;
+    int native_size;
+
+    // Code compiled at runtime by the JIT, see shot_effect_jit.h, and where it stages shot properties as Variants
+    void* jit_code;
+    size_t jit_size;
+    Variant jit_scratch[3];
 
     Ref<ShotEffect> next_pass;
 
+    // Opcode profiler, only collected while profiling is enabled (see Danmaku.set_effect_profiling)
+    static bool profiling;
+    static SelfList<ShotEffect>::List profiled_effects;
+    SelfList<ShotEffect> profile_item;
+    Vector<uint64_t> instruction_counts;
+    uint64_t executions;
+    uint64_t execution_time;
+
 protected:
     static void _bind_methods();
 
@@ -55,6 +123,21 @@ public:
     int div(int p_lhs, int p_rhs, int p_to);
     int mod(int p_lhs, int p_rhs, int p_to);
 
+    int sin(int p_from, int p_to);
+    int cos(int p_from, int p_to);
+    int atan2(int p_y, int p_x, int p_to);
+    int length(int p_from, int p_to);
+    int normalize(int p_from, int p_to);
+    int lerp(int p_target, int p_weight, int p_to);
+    int aim(int p_to);
+
+    int rand(int p_to);
+    int randr(int p_min, int p_max, int p_to);
+
+    int volley(int p_count, const String& p_shape, const String& p_sprite, float p_speed, Ref<ShotEffect> p_effect = Ref<ShotEffect>(), const Array& p_shape_args = Array());
+    int spawn(int p_volley);
+    _FORCE_INLINE_ const Volley& get_volley(int p_volley) const { return volleys[p_volley]; }
+
     int equal(int p_lhs, int p_rhs, int p_jump);
     int less(int p_lhs, int p_rhs, int p_jump);
     int lesseq(int p_lhs, int p_rhs, int p_jump);
@@ -62,6 +145,16 @@ public:
 
     void patch(int p_ins);
 
+    int on(Event p_event);
+    _FORCE_INLINE_ uint32_t get_handler_mask() const {
+        if (handler_mask_revision != handler_revision) {
+            handler_mask = _build_handler_mask();
+            handler_mask_revision = handler_revision;
+        }
+        return handler_mask;
+    }
+    _FORCE_INLINE_ bool handles(Event p_event) const { return get_handler_mask() & (1 << p_event); }
+
     int fire();
     int reset();
 
@@ -82,16 +175,62 @@ public:
     Ref<ShotEffect> get_next_pass() const;
     int get_pass_count() const;
 
+    // See shot_effect_format.h
+    Error save_program(FileAccess* p_file) const;
+    Error load_program(FileAccess* p_file);
+
+    // See shot_effect_aot.h
+    uint64_t get_program_hash() const;
+    bool has_native() const;
+    Error export_native(const String& p_dir) const;
+    static void register_native(uint64_t p_hash, NativeProgram p_program);
+    static void set_native_enabled(bool p_enabled);
+    static bool is_native_enabled();
+
+    // Used by natively compiled programs
+    void set_register(Register p_reg, const Variant& p_value);
+    Variant get_register(Register p_reg) const;
+    _FORCE_INLINE_ Variant* get_current_state() const { return current_state; }
+    _FORCE_INLINE_ Shot* get_current_shot() const { return current_shot; }
+    _FORCE_INLINE_ uint64_t get_current_tick() const { return current_tick; }
+    _FORCE_INLINE_ bool is_handling() const { return handling; }
+    Step _run_command(int* p_ins, int p_end, int p_id);
+    uint64_t _random_bits(int p_id, int p_ins);
+    bool _aim(real_t& r_angle) const;
+
     void execute(Shot* p_shot);
+    void handle(Shot* p_shot, Event p_event, const Variant& p_data);
+
+    static void set_profiling(bool p_profiling);
+    static bool is_profiling();
+    static void reset_profile();
+    static Array get_profile();
+    static String get_profile_table();
+    static Error export_profile(const String& p_path);
 
     ShotEffect();
+    ~ShotEffect();
 
 private:
     void execute_tick(Shot* p_shot, int p_id, Variant* p_state);
     void execute(Shot* p_shot, int p_id, Variant* p_state);
-
-    void set_register(Register p_reg, const Variant& p_value);
-    Variant get_register(Register p_reg) const;
+    void _run(int* p_ins, int p_end, int p_id);
+    void _interpret(int* p_ins, int p_end, int p_id);
+    _FORCE_INLINE_ Step _step(Command p_cmd, int* p_ins, int p_end, int p_id);
+    NativeProgram _get_native();
+    uint32_t _build_handler_mask() const;
+    bool _is_valid_operand(int p_kind, uint8_t p_operand) const;
+    Error _load_program(FileAccess* p_file);
+    Error _validate_program() const;
+    Error _validate_chain() const;
+    Vector<int> _get_program_ends() const;
+    Vector<int> _get_state_types() const;
+    String _generate_native(const String& p_function) const;
+    NativeProgram _compile_jit();
+    void _release_jit();
+    bool _can_sleep_on(Register p_reg, const Variant& p_timer) const;
 };
 
+VARIANT_ENUM_CAST(ShotEffect::Event);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,526 @@
+#include "shot_effect_aot.h"
+#include "shot_effect_jit.h"
+#include "shot_effect_opcodes.h"
+
+#include "core/hashfuncs.h"
+#include "core/os/file_access.h"
+
+HashMap<uint64_t, ShotEffect::NativeProgram> ShotEffect::native_programs;
+bool ShotEffect::native_enabled = true;
+
+static uint64_t _hash_variant(const Variant& p_value, uint64_t p_hash) {
+    p_hash = hash_djb2_one_64(p_value.get_type(), p_hash);
+    if (p_value.get_type() == Variant::OBJECT) {
+        // Object hashes are their addresses, resources are identified by path instead
+        RES resource = p_value;
+        return hash_djb2_one_64(resource.is_valid() ? resource->get_path().hash() : 0, p_hash);
+    }
+    return hash_djb2_one_64(p_value.hash(), p_hash);
+}
+
+uint64_t ShotEffect::get_program_hash() const {
+    uint64_t hash = hash_djb2_one_64(commands.size(), 5381);
+    for (int i = 0; i != commands.size(); ++i) {
+        hash = hash_djb2_one_64(commands[i], hash);
+    }
+    for (int i = 0; i != constants.size(); ++i) {
+        hash = _hash_variant(constants[i], hash);
+    }
+    for (int i = 0; i != states.size(); ++i) {
+        // Only the types, the generated code keeps typed states in locals but still loads their values
+        hash = hash_djb2_one_64(states[i].get_type(), hash);
+    }
+    for (int i = 0; i != EVENT_MAX; ++i) {
+        hash = hash_djb2_one_64(handlers[i], hash);
+    }
+    return hash_djb2_one_64(main_size, hash);
+}
+
+bool ShotEffect::has_native() const {
+    return native_programs.has(get_program_hash());
+}
+
+void ShotEffect::register_native(uint64_t p_hash, NativeProgram p_program) {
+    native_programs.set(p_hash, p_program);
+}
+
+void ShotEffect::set_native_enabled(bool p_enabled) {
+    native_enabled = p_enabled;
+}
+
+bool ShotEffect::is_native_enabled() {
+    return native_enabled;
+}
+
+ShotEffect::NativeProgram ShotEffect::_get_native() {
+    // Programs are built up a command at a time, so look again whenever one has grown
+    int size = commands.size() + constants.size() + states.size();
+    if (native_size != size) {
+        native_size = size;
+        NativeProgram* program = native_programs.empty() ? NULL : native_programs.getptr(get_program_hash());
+        native = program ? *program : NULL;
+
+#ifdef KDANMAKU_JIT_ENABLED
+        // Anything without an ahead of time version gets compiled on the spot instead
+        _release_jit();
+        if (!native) {
+            native = _compile_jit();
+        }
+#endif
+    }
+    return native;
+}
+
+Error ShotEffect::export_native(const String& p_dir) const {
+    for (const ShotEffect* pass = this; pass; pass = pass->next_pass.ptr()) {
+        String function = "kfx_" + String::num_uint64(pass->get_program_hash(), 16).lpad(16, "0");
+        String path = p_dir.plus_file(function + ".gen.cpp");
+
+        Error err;
+        FileAccess* file = FileAccess::open(path, FileAccess::WRITE, &err);
+        ERR_FAIL_COND_V_MSG(err != OK, err, "Cannot write native ShotEffect '" + path + "'.");
+        file->store_string(pass->_generate_native(function));
+        file->close();
+        memdelete(file);
+    }
+    return OK;
+}
+
+static String _real(double p_value) {
+    uint64_t bits;
+    memcpy(&bits, &p_value, sizeof(bits));
+    return "kfx_real(0x" + String::num_uint64(bits, 16) + "ULL)";
+}
+
+// A register or a computed value, as a C++ expression of its static type
+struct KFXValue {
+    int type;
+    String expr;
+    bool nonzero;
+
+    KFXValue(int p_type = KFX_VARIANT, const String& p_expr = String(), bool p_nonzero = false) {
+        type = p_type;
+        expr = p_expr;
+        nonzero = p_nonzero;
+    }
+};
+
+// The shot's motion registers, read and written through their accessors
+static const struct {
+    Register reg;
+    int type;
+    const char* name;
+} kfx_shot_properties[] = {
+    { Shot::POSITION, KFX_VECTOR2, "position" },
+    { Shot::SPEED, KFX_REAL, "speed" },
+    { Shot::DIRECTION, KFX_VECTOR2, "direction" },
+    { Shot::ROTATION, KFX_REAL, "rotation" },
+    { Shot::VELOCITY, KFX_VECTOR2, "velocity" },
+    { Shot::ACCELERATION, KFX_REAL, "acceleration" },
+    { Shot::ANGULAR_VELOCITY, KFX_REAL, "angular_velocity" },
+    { Shot::MIN_SPEED, KFX_REAL, "min_speed" },
+    { Shot::MAX_SPEED, KFX_REAL, "max_speed" },
+    { Shot::HOMING, KFX_REAL, "homing" }
+};
+
+static int _find_shot_property(Register p_reg) {
+    for (int i = 0; i != (int)(sizeof(kfx_shot_properties) / sizeof(kfx_shot_properties[0])); ++i) {
+        if (kfx_shot_properties[i].reg == p_reg) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static KFXValue _read(Register p_reg, const Vector<Variant>& p_constants, const Vector<int>& p_types) {
+    int idx = REG_IDX(p_reg);
+    switch (REG_SRC(p_reg)) {
+        case REG_STATE:
+            if (p_types[idx] != KFX_VARIANT) {
+                return KFXValue(p_types[idx], "s" + itos(idx));
+            }
+            return KFXValue(KFX_VARIANT, "state[" + itos(idx) + "]");
+
+        case REG_VALUE: {
+            const Variant& value = p_constants[idx];
+            switch (value.get_type()) {
+                case Variant::NIL: return KFXValue(KFX_VARIANT, "Variant()");
+                case Variant::BOOL: return KFXValue(KFX_VARIANT, (bool)value ? "Variant(true)" : "Variant(false)");
+                case Variant::INT: return KFXValue(KFX_INT, "(int64_t)" + itos(value) + "LL", (int64_t)value != 0);
+                case Variant::REAL: return KFXValue(KFX_REAL, _real(value), (double)value != 0);
+                case Variant::VECTOR2: {
+                    Vector2 vector = value;
+                    return KFXValue(KFX_VECTOR2, "Vector2(" + _real(vector.x) + ", " + _real(vector.y) + ")");
+                }
+                default: break;
+            }
+        } break;
+
+        case REG_SHOT: {
+            int property = _find_shot_property(p_reg);
+            if (property != -1) {
+                String getter = "shot->get_" + String(kfx_shot_properties[property].name) + "()";
+                int type = kfx_shot_properties[property].type;
+                return KFXValue(type, type == KFX_REAL ? "(double)" + getter : getter);
+            }
+        } break;
+    }
+    return KFXValue(KFX_VARIANT, "p_effect->get_register(" + itos(p_reg) + ")");
+}
+
+static String _variant(const KFXValue& p_value) {
+    return p_value.type == KFX_VARIANT ? p_value.expr : "Variant(" + p_value.expr + ")";
+}
+
+// Variant's float conversion, a Vector2 converts to zero
+static String _float(const KFXValue& p_value) {
+    return p_value.type == KFX_VECTOR2 ? "(real_t)Variant(" + p_value.expr + ")" : "(real_t)(" + p_value.expr + ")";
+}
+
+static bool _is_number(const KFXValue& p_value) {
+    return p_value.type == KFX_INT || p_value.type == KFX_REAL;
+}
+
+static String _double(const KFXValue& p_value) {
+    return p_value.type == KFX_INT ? "(double)" + p_value.expr : p_value.expr;
+}
+
+// Typed versions of Variant::evaluate, only where Variant would compute the same thing
+static KFXValue _evaluate(int p_op, const String& p_op_name, const KFXValue& p_a, const KFXValue& p_b) {
+    static const char* symbols[] = { "+", "-", "*", "/" };
+    String symbol = symbols[p_op - CMD_ADD];
+    bool divide = p_op == CMD_DIV;
+
+    // Integer math stays with Variant, but an int mixed with a float is promoted to double
+    bool real = _is_number(p_a) && _is_number(p_b) && (p_a.type == KFX_REAL || p_b.type == KFX_REAL);
+    if (real && (!divide || p_b.nonzero)) {
+        return KFXValue(KFX_REAL, "(" + _double(p_a) + " " + symbol + " " + _double(p_b) + ")");
+    }
+    if (p_a.type == KFX_VECTOR2 && p_b.type == KFX_VECTOR2 && !divide) {
+        return KFXValue(KFX_VECTOR2, "(" + p_a.expr + " " + symbol + " " + p_b.expr + ")");
+    }
+    if (p_a.type == KFX_VECTOR2 && _is_number(p_b) && (p_op == CMD_MUL || (divide && p_b.nonzero))) {
+        return KFXValue(KFX_VECTOR2, "(" + p_a.expr + " " + symbol + " " + _float(p_b) + ")");
+    }
+    if (_is_number(p_a) && p_b.type == KFX_VECTOR2 && p_op == CMD_MUL) {
+        return KFXValue(KFX_VECTOR2, "(" + p_b.expr + " * " + _float(p_a) + ")");
+    }
+    return KFXValue(KFX_VARIANT, "Variant::evaluate(Variant::" + p_op_name + ", " + _variant(p_a) + ", " + _variant(p_b) + ")");
+}
+
+// The value a command writes, given its operands. p_to is the destination's value before, for lerp
+static KFXValue _result(Command p_cmd, const KFXValue& p_a, const KFXValue& p_b, const KFXValue& p_to, int p_ins) {
+    String random = "CounterRNG::unit(p_effect->_random_bits(p_id, " + itos(p_ins) + "))";
+
+    switch (CMD(p_cmd)) {
+        case CMD_MOVE: return p_a;
+
+        case CMD_ADD: return _evaluate(CMD_ADD, "OP_ADD", p_a, p_b);
+        case CMD_SUB: return _evaluate(CMD_SUB, "OP_SUBTRACT", p_a, p_b);
+        case CMD_MUL: return _evaluate(CMD_MUL, "OP_MULTIPLY", p_a, p_b);
+        case CMD_DIV: return _evaluate(CMD_DIV, "OP_DIVIDE", p_a, p_b);
+        case CMD_MOD: return KFXValue(KFX_VARIANT, "Variant::evaluate(Variant::OP_MODULE, " + _variant(p_a) + ", " + _variant(p_b) + ")");
+
+        case CMD_SIN: return KFXValue(KFX_REAL, "(double)Math::sin(" + _float(p_a) + ")");
+        case CMD_COS: return KFXValue(KFX_REAL, "(double)Math::cos(" + _float(p_a) + ")");
+        case CMD_ATAN2: return KFXValue(KFX_REAL, "(double)Math::atan2(" + _float(p_a) + ", " + _float(p_b) + ")");
+
+        case CMD_LENGTH:
+            if (p_a.type == KFX_VECTOR2) {
+                return KFXValue(KFX_REAL, "(double)" + p_a.expr + ".length()");
+            }
+            if (_is_number(p_a)) {
+                return KFXValue(KFX_REAL, "(double)Math::abs(" + _float(p_a) + ")");
+            }
+            return KFXValue(KFX_REAL, "(double)kfx_length(" + p_a.expr + ")");
+
+        case CMD_NORMALIZE:
+            if (p_a.type == KFX_VECTOR2) {
+                return KFXValue(KFX_VECTOR2, p_a.expr + ".normalized()");
+            }
+            if (_is_number(p_a)) {
+                return KFXValue(KFX_REAL, "kfx_sign(" + _float(p_a) + ")");
+            }
+            return KFXValue(KFX_VARIANT, "kfx_normalize(" + p_a.expr + ")");
+
+        case CMD_LERP:
+            // Variant::interpolate does float math between two numbers, whatever their types
+            if (p_to.type == KFX_REAL && _is_number(p_a)) {
+                return KFXValue(KFX_REAL, "(double)(" + _float(p_to) + " + (" + _float(p_a) + " - " + _float(p_to) + ") * " + _float(p_b) + ")");
+            }
+            if (p_to.type == KFX_VECTOR2 && p_a.type == KFX_VECTOR2) {
+                return KFXValue(KFX_VECTOR2, p_to.expr + ".linear_interpolate(" + p_a.expr + ", " + _float(p_b) + ")");
+            }
+            return KFXValue(KFX_VARIANT, "kfx_lerp(" + _variant(p_to) + ", " + _variant(p_a) + ", " + _float(p_b) + ")");
+
+        case CMD_AIM: return KFXValue(KFX_REAL, "(double)angle");
+        case CMD_RAND: return KFXValue(KFX_REAL, "(double)" + random);
+        case CMD_RANDR: return KFXValue(KFX_REAL, "(double)(" + _float(p_a) + " + (" + _float(p_b) + " - " + _float(p_a) + ") * " + random + ")");
+
+        // Timers count down in whatever type they started as
+        case CMD_TIMER: return p_to;
+    }
+    return KFXValue();
+}
+
+// Which operand a command writes to, or -1
+static int _get_destination(Command p_cmd) {
+    for (int i = 0; i != 3; ++i) {
+        if (command_operands[CMD(p_cmd)][i] == OPERAND_WRITE) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void _read_operands(Command p_cmd, const Vector<Variant>& p_constants, const Vector<int>& p_types, KFXValue* r_operands) {
+    for (int i = 0; i != 3; ++i) {
+        int kind = command_operands[CMD(p_cmd)][i];
+        if (kind == OPERAND_READ || kind == OPERAND_WRITE) {
+            r_operands[i] = _read((p_cmd >> (8 * (i + 1))) & 0xFF, p_constants, p_types);
+        }
+    }
+}
+
+static String _write(Register p_reg, const KFXValue& p_value, const Vector<int>& p_types) {
+    int idx = REG_IDX(p_reg);
+    switch (REG_SRC(p_reg)) {
+        case REG_STATE:
+            if (p_types[idx] != KFX_VARIANT) {
+                return "s" + itos(idx) + " = " + p_value.expr + ";";
+            }
+            return "state[" + itos(idx) + "] = " + _variant(p_value) + ";";
+
+        case REG_SHOT: {
+            // Motion registers are never slept on, so the accessors do all set_register would
+            int property = _find_shot_property(p_reg);
+            if (property != -1 && kfx_shot_properties[property].type == p_value.type) {
+                String value = p_value.type == KFX_REAL ? "(real_t)" + p_value.expr : p_value.expr;
+                return "shot->set_" + String(kfx_shot_properties[property].name) + "(" + value + ");";
+            }
+        } break;
+    }
+    return "p_effect->set_register(" + itos(p_reg) + ", " + _variant(p_value) + ");";
+}
+
+Vector<int> ShotEffect::_get_state_types() const {
+    // A state is typed when its default is, and every command writing to it keeps that type
+    Vector<int> types;
+    for (int i = 0; i != states.size(); ++i) {
+        switch (states[i].get_type()) {
+            case Variant::REAL: types.push_back(KFX_REAL); break;
+            case Variant::VECTOR2: types.push_back(KFX_VECTOR2); break;
+            default: types.push_back(KFX_VARIANT); break;
+        }
+    }
+
+    // Untyping one state can untype the results of commands reading it, so go again until nothing changes
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 0; i != commands.size(); ++i) {
+            Command cmd = commands[i];
+            int destination = _get_destination(cmd);
+            if (destination == -1) {
+                continue;
+            }
+
+            Register reg = (cmd >> (8 * (destination + 1))) & 0xFF;
+            if (REG_SRC(reg) != REG_STATE || types[REG_IDX(reg)] == KFX_VARIANT) {
+                continue;
+            }
+
+            KFXValue operands[3];
+            _read_operands(cmd, constants, types, operands);
+            if (_result(cmd, operands[0], operands[1], operands[destination], i).type != types[REG_IDX(reg)]) {
+                types.write[REG_IDX(reg)] = KFX_VARIANT;
+                changed = true;
+            }
+        }
+    }
+    return types;
+}
+
+Vector<int> ShotEffect::_get_program_ends() const {
+    // Commands where the per-tick program or a handler ends, if that's what is running
+    Vector<int> ends;
+    if (main_size > 0) {
+        ends.push_back(main_size);
+    }
+    for (int i = 0; i != EVENT_MAX; ++i) {
+        if (handlers[i] > 0 && ends.find(handlers[i]) == -1) {
+            ends.push_back(handlers[i]);
+        }
+    }
+    return ends;
+}
+
+// Comparisons Variant would do on the same numbers, or NULL to leave them to Variant::evaluate
+static String _compare(int p_op, const KFXValue& p_a, const KFXValue& p_b) {
+    bool real = _is_number(p_a) && _is_number(p_b) && (p_a.type == KFX_REAL || p_b.type == KFX_REAL);
+    if (real) {
+        static const char* symbols[] = { "==", "<", "<=" };
+        return "(" + _double(p_a) + " " + symbols[p_op - CMD_EQ] + " " + _double(p_b) + ")";
+    }
+    if (p_op == CMD_EQ && p_a.type == KFX_VECTOR2 && p_b.type == KFX_VECTOR2) {
+        return "(" + p_a.expr + " == " + p_b.expr + ")";
+    }
+    return String();
+}
+
+String ShotEffect::_generate_native(const String& p_function) const {
+    int count = commands.size();
+    Vector<int> ends = _get_program_ends();
+    Vector<int> types = _get_state_types();
+
+    // Jumps below every end the program can run up to never need to check where they land
+    int shortest = count;
+    for (int i = 0; i != ends.size(); ++i) {
+        shortest = MIN(shortest, ends[i]);
+    }
+
+    String code = "// Generated by ShotEffect.export_native(), do not edit.\n";
+    code += "// " + (get_path().empty() ? String(get_name()) : get_path()) + "\n\n";
+    code += "#include \"../shot_effect_aot.h\"\n\n";
+    code += "void " + p_function + "(ShotEffect* p_effect, int* p_ins, int p_end, int p_id) {\n";
+    code += "    Shot* shot = p_effect->get_current_shot();\n";
+    code += "    Variant* state = p_effect->get_current_state();\n";
+    code += "    (void)shot;\n";
+    code += "    (void)state;\n";
+
+    // Typed states are loaded into locals and stored back on the way out
+    String store;
+    for (int i = 0; i != types.size(); ++i) {
+        if (types[i] != KFX_VARIANT) {
+            code += "    " + String(types[i] == KFX_REAL ? "double" : "Vector2") + " s" + itos(i) + " = state[" + itos(i) + "];\n";
+            store += "    state[" + itos(i) + "] = s" + itos(i) + ";\n";
+        }
+    }
+    code += "\n";
+
+    code += "    switch (*p_ins) {\n";
+    for (int i = 0; i != count; ++i) {
+        code += "        case " + itos(i) + ": goto L" + itos(i) + ";\n";
+    }
+    code += "        default: goto L" + itos(count) + ";\n";
+    code += "    }\n\n";
+
+    for (int i = 0; i != count; ++i) {
+        Command cmd = commands[i];
+        KFXValue operands[3];
+        _read_operands(cmd, constants, types, operands);
+        const KFXValue& a = operands[0];
+        const KFXValue& b = operands[1];
+
+        // Jumping to or past the end of what's running wraps around and stops, like the interpreter does
+        int target = ARG_C(cmd);
+        String wrap = "*p_ins = " + itos(target) + " % p_end; goto exit;";
+        String jump;
+        if (target < shortest) {
+            jump = "goto L" + itos(target) + ";";
+        } else if (target <= count) {
+            jump = "{ if (" + itos(target) + " < p_end) goto L" + itos(target) + "; " + wrap + " }";
+        } else {
+            jump = "{ " + wrap + " }";
+        }
+
+        code += "L" + itos(i) + ":\n";
+        if (ends.find(i) != -1) {
+            code += "    if (p_end == " + itos(i) + ") { *p_ins = 0; goto exit; }\n";
+        }
+
+        switch (CMD(cmd)) {
+            case CMD_EQ:
+            case CMD_LT:
+            case CMD_LE: {
+                static const char* ops[] = { "OP_EQUAL", "OP_LESS", "OP_LESS_EQUAL" };
+                String condition = _compare(CMD(cmd), a, b);
+                if (condition.empty()) {
+                    condition = "Variant::evaluate(Variant::" + String(ops[CMD(cmd) - CMD_EQ]) + ", " + _variant(a) + ", " + _variant(b) + ").booleanize()";
+                }
+                code += "    if (!" + condition + ") " + jump + "\n";
+            } break;
+
+            case CMD_TEST: {
+                String condition;
+                switch (a.type) {
+                    case KFX_INT:
+                    case KFX_REAL: condition = "(" + a.expr + " != 0)"; break;
+                    case KFX_VECTOR2: condition = "(" + a.expr + " != Vector2())"; break;
+                    default: condition = a.expr + ".booleanize()"; break;
+                }
+                code += "    if (!" + condition + ") " + jump + "\n";
+            } break;
+
+            case CMD_AIM:
+                code += "    {\n";
+                code += "        real_t angle;\n";
+                code += "        if (p_effect->_aim(angle)) {\n";
+                code += "            " + _write(ARG_A(cmd), _result(cmd, a, b, a, i), types) + "\n";
+                code += "        }\n";
+                code += "    }\n";
+                break;
+
+            case CMD_FIRE: code += "    shot->get_pattern()->fire();\n"; break;
+            case CMD_RESET: code += "    shot->get_pattern()->reset();\n"; break;
+            case CMD_SPAWN: code += "    shot->get_pattern()->queue_spawn(p_effect, " + itos(ARG_A(cmd)) + ", shot);\n"; break;
+
+            case CMD_TIMER:
+                if (REG_SRC(ARG_A(cmd)) == REG_STATE && a.type == KFX_REAL) {
+                    // Typed states can always be slept on, the interpreter's timer without the Variant math
+                    code += "    if (p_effect->is_handling()) { *p_ins = " + itos(i) + "; goto exit; }\n";
+                    code += "    if (shot->is_sleeping(p_id)) {\n";
+                    code += "        " + a.expr + " = shot->wake(p_id);\n";
+                    code += "    } else if (" + a.expr + " > 0) {\n";
+                    code += "        shot->sleep(p_id, " + itos(ARG_A(cmd)) + ", Variant(" + a.expr + "), p_effect->get_current_tick(), state);\n";
+                    code += "        *p_ins = " + itos(i) + ";\n";
+                    code += "        goto exit;\n";
+                    code += "    }\n";
+                } else {
+                    // Stopping on a timer never writes to it, so a typed state only needs reloading after a step
+                    bool typed = REG_SRC(ARG_A(cmd)) == REG_STATE && a.type != KFX_VARIANT;
+                    if (typed) {
+                        code += "    state[" + itos(REG_IDX(ARG_A(cmd))) + "] = " + a.expr + ";\n";
+                    }
+                    code += "    *p_ins = " + itos(i) + ";\n";
+                    code += "    if (p_effect->_run_command(p_ins, p_end, p_id) == ShotEffect::STEP_STOP) goto exit;\n";
+                    if (typed) {
+                        code += "    " + a.expr + " = state[" + itos(REG_IDX(ARG_A(cmd))) + "];\n";
+                    }
+                }
+                break;
+
+            case CMD_YIELD:
+                code += "    *p_ins = " + itos(i + 1) + " % p_end;\n";
+                code += "    goto exit;\n";
+                break;
+
+            case CMD_END:
+                code += "    *p_ins = -1;\n";
+                code += "    goto exit;\n";
+                break;
+
+            case CMD_CLEAR:
+                code += "    shot->clear();\n";
+                code += "    *p_ins = " + itos(i) + ";\n";
+                code += "    goto exit;\n";
+                break;
+
+            case CMD_SFX: code += "    shot->get_pattern()->play_sfx(" + _variant(a) + ");\n"; break;
+            case CMD_DEBUG: code += "    print_line(" + _variant(a) + ");\n"; break;
+
+            default: {
+                int destination = _get_destination(cmd);
+                Register reg = (cmd >> (8 * (destination + 1))) & 0xFF;
+                code += "    " + _write(reg, _result(cmd, a, b, operands[destination], i), types) + "\n";
+            } break;
+        }
+    }
+
+    code += "L" + itos(count) + ":\n";
+    code += "    *p_ins = 0;\n";
+    code += "exit:\n";
+    code += store.empty() ? String("    return;\n") : store;
+    code += "}\n";
+    return code;
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+// ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
+// *:･ﾟ✧ shot_effect_aot.hpp *:･ﾟ✧
+//
+// Ahead of time compilation of ShotEffects. export_native() writes each pass of an effect out as
+// a C++ function into the module's aot/ directory: every command gets a label, jumps become gotos,
+// constants become literals and state registers are accessed directly. State registers that only
+// ever hold a float or a Vector2 live in typed locals, and math on them, on constants and on the
+// shot's motion registers is plain C++ instead of Variant::evaluate. Everything else goes through
+// Variant the same way the interpreter does, only timers on untyped registers call back into it.
+//
+// SCsub compiles every aot/kfx_*.gen.cpp into the module and generates aot_registry.gen.cpp,
+// which registers each function under the hash of the program it was compiled from. ShotEffects
+// whose program hashes the same then run the native function instead of being interpreted, and
+// go back to the interpreter as soon as their program changes.
+// ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
+
+#ifndef SHOT_EFFECT_AOT_H
+#define SHOT_EFFECT_AOT_H
+
+#include "counter_rng.h"
+#include "pattern.h"
+#include "shot.h"
+#include "shot_effect.h"
+
+#include "core/math/math_funcs.h"
+#include "core/print_string.h"
+
+#include <string.h>
+
+// Constants are written out bit for bit, so a compiled program computes exactly what the interpreter would
+static _FORCE_INLINE_ double kfx_real(uint64_t p_bits) {
+    double value;
+    memcpy(&value, &p_bits, sizeof(value));
+    return value;
+}
+
+// Normalizing a number keeps its sign, zero stays zero
+static _FORCE_INLINE_ double kfx_sign(real_t p_value) {
+    return p_value == 0 ? 0.0 : SGN(p_value);
+}
+
+// Fallbacks for registers whose type isn't known until the program runs, same as the interpreter
+static _FORCE_INLINE_ real_t kfx_length(const Variant& p_value) {
+    if (p_value.get_type() == Variant::VECTOR2) {
+        return ((Vector2)p_value).length();
+    }
+    return Math::abs((real_t)p_value);
+}
+
+static _FORCE_INLINE_ Variant kfx_normalize(const Variant& p_value) {
+    if (p_value.get_type() == Variant::VECTOR2) {
+        return ((Vector2)p_value).normalized();
+    }
+    return kfx_sign(p_value);
+}
+
+static _FORCE_INLINE_ Variant kfx_lerp(const Variant& p_from, const Variant& p_to, float p_weight) {
+    Variant result;
+    Variant::interpolate(p_from, p_to, p_weight, result);
+    return result;
+}
+
+// Generated by SCsub
+void register_aot_effects();
+
+#endif
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "shot_effect_format.h"
+#include "shot_effect.h"
+
+#include "core/os/file_access.h"
+
+// Files being loaded on this thread, an effect that leads back to one of them through its next pass
+// or volleys would otherwise load itself forever
+static thread_local Vector<String> loading_paths;
+
+RES ResourceFormatLoaderShotEffect::load(const String& p_path, const String& p_original_path, Error* r_error) {
+    if (r_error) {
+        *r_error = ERR_CANT_OPEN;
+    }
+    if (loading_paths.find(p_path) != -1) {
+        if (r_error) {
+            *r_error = ERR_CYCLIC_LINK;
+        }
+        ERR_FAIL_V_MSG(RES(), "ShotEffect file '" + p_path + "' refers back to itself through its next pass or volleys.");
+    }
+
+    Error err;
+    FileAccess* file = FileAccess::open(p_path, FileAccess::READ, &err);
+    ERR_FAIL_COND_V_MSG(err != OK, RES(), "Cannot open ShotEffect file '" + p_path + "'.");
+
+    Ref<ShotEffect> effect;
+    effect.instance();
+    loading_paths.push_back(p_path);
+    err = effect->load_program(file);
+    loading_paths.erase(p_path);
+    file->close();
+    memdelete(file);
+
+    if (r_error) {
+        *r_error = err;
+    }
+    ERR_FAIL_COND_V_MSG(err != OK, RES(), "Cannot load ShotEffect file '" + p_path + "'.");
+    return effect;
+}
+
+void ResourceFormatLoaderShotEffect::get_recognized_extensions(List<String>* p_extensions) const {
+    p_extensions->push_back("kfx");
+}
+
+bool ResourceFormatLoaderShotEffect::handles_type(const String& p_type) const {
+    return p_type == "ShotEffect";
+}
+
+String ResourceFormatLoaderShotEffect::get_resource_type(const String& p_path) const {
+    return p_path.get_extension().to_lower() == "kfx" ? "ShotEffect" : "";
+}
+
+Error ResourceFormatSaverShotEffect::save(const String& p_path, const RES& p_resource, uint32_t p_flags) {
+    Ref<ShotEffect> effect = p_resource;
+    ERR_FAIL_COND_V(effect.is_null(), ERR_INVALID_PARAMETER);
+
+    Error err;
+    FileAccess* file = FileAccess::open(p_path, FileAccess::WRITE, &err);
+    ERR_FAIL_COND_V_MSG(err != OK, err, "Cannot save ShotEffect file '" + p_path + "'.");
+
+    err = effect->save_program(file);
+    file->close();
+    memdelete(file);
+    return err;
+}
+
+bool ResourceFormatSaverShotEffect::recognize(const RES& p_resource) const {
+    return Object::cast_to<ShotEffect>(*p_resource) != NULL;
+}
+
+void ResourceFormatSaverShotEffect::get_recognized_extensions(const RES& p_resource, List<String>* p_extensions) const {
+    if (recognize(p_resource)) {
+        p_extensions->push_back("kfx");
+    }
+}
\ No newline at end of file
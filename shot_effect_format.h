@@ -0,0 +1,40 @@
+// ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
+// *:･ﾟ✧ shot_effect_format.hpp *:･ﾟ✧
+//
+// Saves and loads compiled ShotEffects as .kfx files, so effect libraries don't have to be
+// rebuilt from script every time the game starts. A .kfx file holds a "KFX" magic, a format
+// version, and then the program as ShotEffect keeps it in memory: the command list is read back
+// with a single read straight into the effect, only constants and volleys are decoded one by one.
+//
+// Other resources an effect refers to (its next pass, volley effects, resource constants) are
+// stored by path, so they need to be saved to their own files first.
+// ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
+
+#ifndef SHOT_EFFECT_FORMAT_H
+#define SHOT_EFFECT_FORMAT_H
+
+#include "core/io/resource_loader.h"
+#include "core/io/resource_saver.h"
+
+#define KFX_VERSION 2
+
+class ResourceFormatLoaderShotEffect : public ResourceFormatLoader {
+    GDCLASS(ResourceFormatLoaderShotEffect, ResourceFormatLoader);
+
+public:
+    virtual RES load(const String& p_path, const String& p_original_path = "", Error* r_error = NULL);
+    virtual void get_recognized_extensions(List<String>* p_extensions) const;
+    virtual bool handles_type(const String& p_type) const;
+    virtual String get_resource_type(const String& p_path) const;
+};
+
+class ResourceFormatSaverShotEffect : public ResourceFormatSaver {
+    GDCLASS(ResourceFormatSaverShotEffect, ResourceFormatSaver);
+
+public:
+    virtual Error save(const String& p_path, const RES& p_resource, uint32_t p_flags = 0);
+    virtual bool recognize(const RES& p_resource) const;
+    virtual void get_recognized_extensions(const RES& p_resource, List<String>* p_extensions) const;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,648 @@
+#include "shot_effect_jit.h"
+#include "shot.h"
+#include "shot_effect.h"
+
+#ifdef KDANMAKU_JIT_ENABLED
+
+#include "shot_effect_opcodes.h"
+
+#include <string.h>
+#include <sys/mman.h>
+
+// Just enough of an x86-64 assembler for the code below, with rel32 labels patched at the end
+class KFXEmitter {
+    struct Fixup {
+        int at;
+        int label;
+        int base;
+    };
+
+    Vector<uint8_t> code;
+    Vector<int> labels;
+    Vector<Fixup> fixups;
+
+    void _fixup(int p_label, int p_base) {
+        Fixup fixup;
+        fixup.at = code.size();
+        fixup.label = p_label;
+        fixup.base = p_base;
+        fixups.push_back(fixup);
+        d(0);
+    }
+
+public:
+    _FORCE_INLINE_ void b(uint8_t p_byte) { code.push_back(p_byte); }
+
+    void b(uint8_t p_a, uint8_t p_b) {
+        b(p_a);
+        b(p_b);
+    }
+
+    void b(uint8_t p_a, uint8_t p_b, uint8_t p_c) {
+        b(p_a, p_b);
+        b(p_c);
+    }
+
+    void b(uint8_t p_a, uint8_t p_b, uint8_t p_c, uint8_t p_d) {
+        b(p_a, p_b);
+        b(p_c, p_d);
+    }
+
+    void d(uint32_t p_value) {
+        for (int i = 0; i != 4; ++i) {
+            b((p_value >> (i * 8)) & 0xFF);
+        }
+    }
+
+    void q(uint64_t p_value) {
+        for (int i = 0; i != 8; ++i) {
+            b((p_value >> (i * 8)) & 0xFF);
+        }
+    }
+
+    int new_label() {
+        labels.push_back(-1);
+        return labels.size() - 1;
+    }
+
+    void bind(int p_label) { labels.write[p_label] = code.size(); }
+
+    // rel32 operand relative to the end of the instruction
+    void rel(int p_label) { _fixup(p_label, -1); }
+
+    // Table entry holding p_label's offset from p_table
+    void entry(int p_label, int p_table) { _fixup(p_label, p_table); }
+
+    void jmp(int p_label) {
+        b(0xE9);
+        rel(p_label);
+    }
+
+    void jcc(uint8_t p_cc, int p_label) {
+        b(0x0F, p_cc);
+        rel(p_label);
+    }
+
+    // mov rax, imm64; call rax
+    void call(const void* p_function) {
+        b(0x48, 0xB8);
+        q((uint64_t)p_function);
+        b(0xFF, 0xD0);
+    }
+
+    bool finish() {
+        for (int i = 0; i != fixups.size(); ++i) {
+            const Fixup& fixup = fixups[i];
+            int target = labels[fixup.label];
+            ERR_FAIL_COND_V(target == -1, false);
+            int base = fixup.base == -1 ? fixup.at + 4 : labels[fixup.base];
+            uint32_t value = (uint32_t)(target - base);
+            memcpy(code.ptrw() + fixup.at, &value, 4);
+        }
+        return true;
+    }
+
+    _FORCE_INLINE_ const Vector<uint8_t>& get_code() const { return code; }
+};
+
+#define JCC_E 0x84
+#define JCC_NE 0x85
+#define JCC_AE 0x83
+#define JCC_G 0x8F
+
+// Called from compiled code, which keeps the effect in rbx, p_ins in r12, p_end in r13d,
+// p_id in r14d, the running shot's state registers in r15, its REG0-7 in rbp and which of
+// those are being slept on at [rsp]
+
+static Variant* _jit_state(ShotEffect* p_effect) {
+    return p_effect->get_current_state();
+}
+
+static Variant* _jit_shot_registers(ShotEffect* p_effect, uint32_t* r_sleeping) {
+    Shot* shot = p_effect->get_current_shot();
+    *r_sleeping = shot->get_sleeping_registers();
+    return shot->get_registers();
+}
+
+static int _jit_step(ShotEffect* p_effect, int* p_ins, int p_end, int p_id) {
+    return p_effect->_run_command(p_ins, p_end, p_id);
+}
+
+static void _jit_copy(const Variant* p_from, Variant* p_to) {
+    *p_to = *p_from;
+}
+
+static void _jit_evaluate(const Variant* p_a, const Variant* p_b, Variant* p_to, int p_op) {
+    *p_to = Variant::evaluate((Variant::Operator)p_op, *p_a, *p_b);
+}
+
+static bool _jit_test(ShotEffect* p_effect, uint32_t p_cmd) {
+    Variant a = p_effect->get_register(ARG_A(p_cmd));
+    switch (CMD(p_cmd)) {
+        case CMD_EQ: return Variant::evaluate(Variant::OP_EQUAL, a, p_effect->get_register(ARG_B(p_cmd))).booleanize();
+        case CMD_LT: return Variant::evaluate(Variant::OP_LESS, a, p_effect->get_register(ARG_B(p_cmd))).booleanize();
+        case CMD_LE: return Variant::evaluate(Variant::OP_LESS_EQUAL, a, p_effect->get_register(ARG_B(p_cmd))).booleanize();
+        default: return a.booleanize();
+    }
+}
+
+// The shot's motion registers aren't Variants, they're staged through the effect's scratch Variants
+#define JIT_SHOT_PROPERTY(m_name)                                                  \
+    static void _jit_get_##m_name(ShotEffect* p_effect, Variant* p_to) {           \
+        *p_to = p_effect->get_current_shot()->get_##m_name();                      \
+    }                                                                              \
+    static void _jit_set_##m_name(ShotEffect* p_effect, const Variant* p_from) {   \
+        p_effect->get_current_shot()->set_##m_name(*p_from);                       \
+    }
+
+JIT_SHOT_PROPERTY(position)
+JIT_SHOT_PROPERTY(speed)
+JIT_SHOT_PROPERTY(direction)
+JIT_SHOT_PROPERTY(rotation)
+JIT_SHOT_PROPERTY(velocity)
+
+static const struct {
+    Register reg;
+    void (*get)(ShotEffect*, Variant*);
+    void (*set)(ShotEffect*, const Variant*);
+} jit_shot_properties[] = {
+    { Shot::POSITION, &_jit_get_position, &_jit_set_position },
+    { Shot::SPEED, &_jit_get_speed, &_jit_set_speed },
+    { Shot::DIRECTION, &_jit_get_direction, &_jit_set_direction },
+    { Shot::ROTATION, &_jit_get_rotation, &_jit_set_rotation },
+    { Shot::VELOCITY, &_jit_get_velocity, &_jit_set_velocity }
+};
+
+static int _find_shot_property(Register p_reg) {
+    for (int i = 0; i != (int)(sizeof(jit_shot_properties) / sizeof(jit_shot_properties[0])); ++i) {
+        if (jit_shot_properties[i].reg == p_reg) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// REG0-7 are plain Variants at a fixed offset, unless a timer is sleeping on them
+static _FORCE_INLINE_ bool _is_shot_slot(Register p_reg) {
+    return REG_SRC(p_reg) == REG_SHOT && REG_IDX(p_reg) < SHOT_REGISTERS;
+}
+
+// Registers compiled code reaches without going through the interpreter
+static _FORCE_INLINE_ bool _is_direct(Register p_reg) {
+    return REG_SRC(p_reg) == REG_STATE || REG_SRC(p_reg) == REG_VALUE || _is_shot_slot(p_reg) || _find_shot_property(p_reg) != -1;
+}
+
+static _FORCE_INLINE_ bool _is_direct_destination(Register p_reg) {
+    return REG_SRC(p_reg) != REG_VALUE && _is_direct(p_reg);
+}
+
+// mov rdi, rbx; mov rsi, scratch; call p_function
+static void _emit_scratch_call(KFXEmitter& e, const void* p_function, const Variant* p_scratch) {
+    e.b(0x48, 0x89, 0xDF);
+    e.b(0x48, 0xBE);
+    e.q((uint64_t)p_scratch);
+    e.call(p_function);
+}
+
+// Loads a direct register's address into rdi (0), rsi (1) or rdx (2), shot properties use scratch p_arg
+static void _load_address(KFXEmitter& e, int p_arg, Register p_reg, const Vector<Variant>& p_constants, const Variant* p_scratch) {
+    static const uint8_t mov[3] = { 0xBF, 0xBE, 0xBA };
+    static const uint8_t lea_r15[3] = { 0xBF, 0xB7, 0x97 };
+    static const uint8_t lea_rbp[3] = { 0xBD, 0xB5, 0x95 };
+
+    switch (REG_SRC(p_reg)) {
+        case REG_STATE:
+            // lea r64, [r15 + disp32]
+            e.b(0x49, 0x8D, lea_r15[p_arg]);
+            e.d(REG_IDX(p_reg) * sizeof(Variant));
+            break;
+
+        case REG_SHOT:
+            if (_is_shot_slot(p_reg)) {
+                // lea r64, [rbp + disp32]
+                e.b(0x48, 0x8D, lea_rbp[p_arg]);
+                e.d(REG_IDX(p_reg) * sizeof(Variant));
+            } else {
+                // mov r64, imm64
+                e.b(0x48, mov[p_arg]);
+                e.q((uint64_t)(p_scratch + p_arg));
+            }
+            break;
+
+        default:
+            // mov r64, imm64
+            e.b(0x48, mov[p_arg]);
+            e.q((uint64_t)(p_constants.ptr() + REG_IDX(p_reg)));
+            break;
+    }
+}
+
+// Calls p_function with the addresses of p_count direct registers, the last of which it writes to
+static void _emit_direct(KFXEmitter& e, const Register* p_regs, int p_count, const void* p_function, int p_op, const Vector<Variant>& p_constants, Variant* p_scratch) {
+    for (int i = 0; i != p_count - 1; ++i) {
+        int property = _find_shot_property(p_regs[i]);
+        if (property != -1) {
+            _emit_scratch_call(e, (const void*)jit_shot_properties[property].get, p_scratch + i);
+        }
+    }
+
+    for (int i = 0; i != p_count; ++i) {
+        _load_address(e, i, p_regs[i], p_constants, p_scratch);
+    }
+    if (p_op != -1) {
+        // mov ecx, op
+        e.b(0xB9);
+        e.d(p_op);
+    }
+    e.call(p_function);
+
+    int property = _find_shot_property(p_regs[p_count - 1]);
+    if (property != -1) {
+        _emit_scratch_call(e, (const void*)jit_shot_properties[property].set, p_scratch + p_count - 1);
+    }
+}
+
+// Jumps to a new label for the interpreter's path if any REG0-7 used is being slept on, or returns -1
+static int _emit_sleep_check(KFXEmitter& e, const Register* p_regs, int p_count) {
+    uint32_t mask = 0;
+    for (int i = 0; i != p_count; ++i) {
+        if (_is_shot_slot(p_regs[i])) {
+            mask |= 1 << REG_IDX(p_regs[i]);
+        }
+    }
+    if (!mask) {
+        return -1;
+    }
+
+    // test dword [rsp], mask; jnz slow
+    int slow = e.new_label();
+    e.b(0xF7, 0x04, 0x24);
+    e.d(mask);
+    e.jcc(JCC_NE, slow);
+    return slow;
+}
+
+// *p_ins = p_next % p_end, then leave
+static void _emit_wrap(KFXEmitter& e, int p_next, int p_exit) {
+    e.b(0xB8);
+    e.d(p_next);
+    e.b(0x31, 0xD2);
+    e.b(0x41, 0xF7, 0xF5);
+    e.b(0x41, 0x89, 0x14, 0x24);
+    e.jmp(p_exit);
+}
+
+// Where a Variant keeps a REAL's double, found by storing one rather than relying on Variant's private layout
+static int _get_real_offset() {
+    static int offset = -2;
+    if (offset == -2) {
+        const double probe = 1234.5678;
+        Variant value = probe;
+        offset = -1;
+        for (int i = 0; i + (int)sizeof(double) <= (int)sizeof(Variant); i += (int)sizeof(uint32_t)) {
+            if (memcmp((const uint8_t*)&value + i, &probe, sizeof(double)) == 0) {
+                offset = i;
+                break;
+            }
+        }
+    }
+    return offset;
+}
+
+// States the type inference proved always hold a REAL
+static _FORCE_INLINE_ bool _is_real_state(Register p_reg, const Vector<int>& p_types) {
+    return REG_SRC(p_reg) == REG_STATE && REG_IDX(p_reg) < p_types.size() && p_types[REG_IDX(p_reg)] == KFX_REAL;
+}
+
+static bool _is_real(Register p_reg, const Vector<Variant>& p_constants, const Vector<int>& p_types) {
+    if (REG_SRC(p_reg) == REG_VALUE) {
+        return p_constants[REG_IDX(p_reg)].get_type() == Variant::REAL;
+    }
+    return _is_real_state(p_reg, p_types);
+}
+
+// Numbers kept in xmm registers, an int constant is promoted to double the same way Variant does
+static bool _is_number(Register p_reg, const Vector<Variant>& p_constants, const Vector<int>& p_types) {
+    if (REG_SRC(p_reg) == REG_VALUE) {
+        return p_constants[REG_IDX(p_reg)].get_type() == Variant::INT || p_constants[REG_IDX(p_reg)].get_type() == Variant::REAL;
+    }
+    return _is_real_state(p_reg, p_types);
+}
+
+// Loads a number into xmm0 (0) or xmm1 (1), constants are baked in as immediates
+static void _emit_load_number(KFXEmitter& e, int p_xmm, Register p_reg, const Vector<Variant>& p_constants, int p_offset) {
+    if (REG_SRC(p_reg) == REG_STATE) {
+        // movsd xmm, [r15 + disp32]
+        e.b(0xF2, 0x41, 0x0F, 0x10);
+        e.b(0x87 | (p_xmm << 3));
+        e.d(REG_IDX(p_reg) * sizeof(Variant) + p_offset);
+    } else {
+        // mov rax, imm64; movq xmm, rax
+        double value = p_constants[REG_IDX(p_reg)];
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        e.b(0x48, 0xB8);
+        e.q(bits);
+        e.b(0x66, 0x48, 0x0F, 0x6E);
+        e.b(0xC0 | (p_xmm << 3));
+    }
+}
+
+// movsd [r15 + disp32], xmm0, the state already holds a REAL so only its double changes
+static void _emit_store_number(KFXEmitter& e, Register p_reg, int p_offset) {
+    e.b(0xF2, 0x41, 0x0F, 0x11);
+    e.b(0x87);
+    e.d(REG_IDX(p_reg) * sizeof(Variant) + p_offset);
+}
+
+ShotEffect::NativeProgram ShotEffect::_compile_jit() {
+    int count = commands.size();
+    if (count == 0) {
+        return NULL;
+    }
+
+    // Jumps below every end the program can run up to never need to check where they land
+    Vector<int> ends = _get_program_ends();
+    int shortest = count;
+    for (int i = 0; i != ends.size(); ++i) {
+        shortest = MIN(shortest, ends[i]);
+    }
+    // Without knowing where Variant keeps its double, typed states go through Variant like the rest
+    int real_offset = _get_real_offset();
+    Vector<int> types = real_offset != -1 ? _get_state_types() : Vector<int>();
+    KFXEmitter e;
+
+    Vector<int> labels;
+    for (int i = 0; i <= count; ++i) {
+        labels.push_back(e.new_label());
+    }
+    int table = e.new_label();
+    int exit = e.new_label();
+
+    // push rbx, rbp, r12-r15; sub rsp, 8, which leaves the stack aligned for calls
+    e.b(0x53);
+    e.b(0x55);
+    e.b(0x41, 0x54);
+    e.b(0x41, 0x55);
+    e.b(0x41, 0x56);
+    e.b(0x41, 0x57);
+    e.b(0x48, 0x83, 0xEC, 0x08);
+
+    // mov rbx, rdi; mov r12, rsi; mov r13d, edx; mov r14d, ecx
+    e.b(0x48, 0x89, 0xFB);
+    e.b(0x49, 0x89, 0xF4);
+    e.b(0x41, 0x89, 0xD5);
+    e.b(0x41, 0x89, 0xCE);
+
+    // r15 = state registers of the shot being run
+    e.b(0x48, 0x89, 0xDF);
+    e.call((const void*)&_jit_state);
+    e.b(0x49, 0x89, 0xC7);
+
+    // rbp = REG0-7 of the shot being run, [rsp] = which are slept on
+    e.b(0x48, 0x89, 0xDF);
+    e.b(0x48, 0x89, 0xE6);
+    e.call((const void*)&_jit_shot_registers);
+    e.b(0x48, 0x89, 0xC5);
+
+    // mov eax, [r12]; cmp eax, count; jae end
+    e.b(0x41, 0x8B, 0x04, 0x24);
+    e.b(0x3D);
+    e.d(count);
+    e.jcc(JCC_AE, labels[count]);
+
+    // lea rcx, [rip + table]; movsxd rax, [rcx + rax * 4]; add rax, rcx; jmp rax
+    e.b(0x48, 0x8D, 0x0D);
+    e.rel(table);
+    e.b(0x48, 0x63, 0x04, 0x81);
+    e.b(0x48, 0x01, 0xC8);
+    e.b(0xFF, 0xE0);
+
+    e.bind(table);
+    for (int i = 0; i != count; ++i) {
+        e.entry(labels[i], table);
+    }
+
+    for (int i = 0; i != count; ++i) {
+        Command cmd = commands[i];
+        Register a = ARG_A(cmd);
+        Register b = ARG_B(cmd);
+        Register c = ARG_C(cmd);
+
+        e.bind(labels[i]);
+        if (ends.find(i) != -1) {
+            // cmp r13d, i; jne next; mov dword [r12], 0; jmp exit
+            int next = e.new_label();
+            e.b(0x41, 0x81, 0xFD);
+            e.d(i);
+            e.jcc(JCC_NE, next);
+            e.b(0x41, 0xC7, 0x04, 0x24);
+            e.d(0);
+            e.jmp(exit);
+            e.bind(next);
+        }
+
+        // The interpreter's path, which direct commands still fall back to while a register they use is slept on
+        int slow = -1;
+        bool direct = false;
+
+        switch (CMD(cmd)) {
+            case CMD_MOVE:
+                if (_is_real(a, constants, types) && _is_real_state(b, types)) {
+                    _emit_load_number(e, 0, a, constants, real_offset);
+                    _emit_store_number(e, b, real_offset);
+                    continue;
+                }
+                if (_is_direct(a) && _is_direct_destination(b)) {
+                    Register regs[] = { a, b };
+                    slow = _emit_sleep_check(e, regs, 2);
+                    _emit_direct(e, regs, 2, (const void*)&_jit_copy, -1, constants, jit_scratch);
+                    direct = true;
+                }
+                break;
+
+            case CMD_ADD:
+            case CMD_SUB:
+            case CMD_MUL:
+            case CMD_DIV:
+            case CMD_MOD:
+                // Float math on typed states, dividing only by a constant that can't be zero since Variant errors on that
+                if (CMD(cmd) != CMD_MOD && _is_number(a, constants, types) && _is_number(b, constants, types) &&
+                        (_is_real(a, constants, types) || _is_real(b, constants, types)) && _is_real_state(c, types) &&
+                        (CMD(cmd) != CMD_DIV || (REG_SRC(b) == REG_VALUE && (double)constants[REG_IDX(b)] != 0))) {
+                    // addsd, subsd, mulsd or divsd xmm0, xmm1
+                    static const uint8_t sse_ops[] = { 0x58, 0x5C, 0x59, 0x5E };
+                    _emit_load_number(e, 0, a, constants, real_offset);
+                    _emit_load_number(e, 1, b, constants, real_offset);
+                    e.b(0xF2, 0x0F, sse_ops[CMD(cmd) - CMD_ADD], 0xC1);
+                    _emit_store_number(e, c, real_offset);
+                    continue;
+                }
+                if (_is_direct(a) && _is_direct(b) && _is_direct_destination(c)) {
+                    static const Variant::Operator ops[] = { Variant::OP_ADD, Variant::OP_SUBTRACT, Variant::OP_MULTIPLY, Variant::OP_DIVIDE, Variant::OP_MODULE };
+                    Register regs[] = { a, b, c };
+                    slow = _emit_sleep_check(e, regs, 3);
+                    _emit_direct(e, regs, 3, (const void*)&_jit_evaluate, ops[CMD(cmd) - CMD_ADD], constants, jit_scratch);
+                    direct = true;
+                }
+                break;
+
+            case CMD_EQ:
+            case CMD_LT:
+            case CMD_LE:
+            case CMD_TEST:
+                if (CMD(cmd) == CMD_TEST ? _is_real(a, constants, types) :
+                        _is_number(a, constants, types) && _is_number(b, constants, types) && (_is_real(a, constants, types) || _is_real(b, constants, types))) {
+                    // Compared as doubles into al, false whenever either side is NaN like Variant
+                    _emit_load_number(e, 0, a, constants, real_offset);
+                    switch (CMD(cmd)) {
+                        case CMD_EQ:
+                            // ucomisd xmm0, xmm1; sete al; setnp cl; and al, cl
+                            _emit_load_number(e, 1, b, constants, real_offset);
+                            e.b(0x66, 0x0F, 0x2E, 0xC1);
+                            e.b(0x0F, 0x94, 0xC0);
+                            e.b(0x0F, 0x9B, 0xC1);
+                            e.b(0x20, 0xC8);
+                            break;
+
+                        case CMD_LT:
+                            // ucomisd xmm1, xmm0; seta al
+                            _emit_load_number(e, 1, b, constants, real_offset);
+                            e.b(0x66, 0x0F, 0x2E, 0xC8);
+                            e.b(0x0F, 0x97, 0xC0);
+                            break;
+
+                        case CMD_LE:
+                            // ucomisd xmm1, xmm0; setae al
+                            _emit_load_number(e, 1, b, constants, real_offset);
+                            e.b(0x66, 0x0F, 0x2E, 0xC8);
+                            e.b(0x0F, 0x93, 0xC0);
+                            break;
+
+                        default:
+                            // Anything but zero is true, NaN included: xorpd xmm1, xmm1; ucomisd xmm0, xmm1; setne al; setp cl; or al, cl
+                            e.b(0x66, 0x0F, 0x57, 0xC9);
+                            e.b(0x66, 0x0F, 0x2E, 0xC1);
+                            e.b(0x0F, 0x95, 0xC0);
+                            e.b(0x0F, 0x9A, 0xC1);
+                            e.b(0x08, 0xC8);
+                            break;
+                    }
+                } else {
+                    // mov rdi, rbx; mov esi, cmd; call _jit_test
+                    e.b(0x48, 0x89, 0xDF);
+                    e.b(0xBE);
+                    e.d(cmd);
+                    e.call((const void*)&_jit_test);
+                }
+                // test al, al; je target
+                e.b(0x84, 0xC0);
+                if (c < shortest) {
+                    e.jcc(JCC_E, labels[c]);
+                } else {
+                    // Jumping to or past the end of what's running wraps around and stops, like the interpreter does
+                    int next = e.new_label();
+                    e.jcc(JCC_NE, next);
+                    if (c <= count) {
+                        // cmp r13d, c; jg target
+                        e.b(0x41, 0x81, 0xFD);
+                        e.d(c);
+                        e.jcc(JCC_G, labels[c]);
+                    }
+                    _emit_wrap(e, c, exit);
+                    e.bind(next);
+                }
+                continue;
+
+            case CMD_YIELD:
+                _emit_wrap(e, i + 1, exit);
+                continue;
+
+            case CMD_END:
+                e.b(0x41, 0xC7, 0x04, 0x24);
+                e.d(-1);
+                e.jmp(exit);
+                continue;
+        }
+
+        if (direct && slow == -1) {
+            continue;
+        }
+
+        int done = -1;
+        if (direct) {
+            done = e.new_label();
+            e.jmp(done);
+            e.bind(slow);
+        }
+
+        // mov dword [r12], i; then _run_command(p_ins, p_end, p_id) and leave if it stopped
+        e.b(0x41, 0xC7, 0x04, 0x24);
+        e.d(i);
+        e.b(0x48, 0x89, 0xDF);
+        e.b(0x4C, 0x89, 0xE6);
+        e.b(0x44, 0x89, 0xEA);
+        e.b(0x44, 0x89, 0xF1);
+        e.call((const void*)&_jit_step);
+        e.b(0x83, 0xF8, STEP_STOP);
+        e.jcc(JCC_E, exit);
+
+        if (direct) {
+            e.bind(done);
+        }
+    }
+
+    // Running off the end starts over next time
+    e.bind(labels[count]);
+    e.b(0x41, 0xC7, 0x04, 0x24);
+    e.d(0);
+
+    // add rsp, 8; pop r15-r12, rbp, rbx; ret
+    e.bind(exit);
+    e.b(0x48, 0x83, 0xC4, 0x08);
+    e.b(0x41, 0x5F);
+    e.b(0x41, 0x5E);
+    e.b(0x41, 0x5D);
+    e.b(0x41, 0x5C);
+    e.b(0x5D);
+    e.b(0x5B);
+    e.b(0xC3);
+
+    if (!e.finish()) {
+        return NULL;
+    }
+
+    // Written while writable, then flipped to executable so the pages are never both
+    const Vector<uint8_t>& code = e.get_code();
+    size_t size = code.size();
+    void* pages = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ERR_FAIL_COND_V_MSG(pages == MAP_FAILED, NULL, "Cannot allocate memory for compiled ShotEffect.");
+    memcpy(pages, code.ptr(), size);
+    if (mprotect(pages, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(pages, size);
+        ERR_FAIL_V_MSG(NULL, "Cannot make compiled ShotEffect executable.");
+    }
+
+    jit_code = pages;
+    jit_size = size;
+    return (NativeProgram)jit_code;
+}
+
+void ShotEffect::_release_jit() {
+    if (jit_code) {
+        munmap(jit_code, jit_size);
+        jit_code = NULL;
+        jit_size = 0;
+    }
+}
+
+#else
+
+ShotEffect::NativeProgram ShotEffect::_compile_jit() {
+    return NULL;
+}
+
+void ShotEffect::_release_jit() {
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,26 @@
+// ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
+// *:･ﾟ✧ shot_effect_jit.hpp *:･ﾟ✧
+//
+// Runtime compilation of ShotEffects to x86-64 machine code, for development builds that can't
+// wait on export_native() and a rebuild. Enabled with kdanmaku_jit=yes, and only on x86-64 Linux:
+// everywhere else effects without an ahead of time version keep being interpreted.
+//
+// The compiled code follows the same shape as the ahead of time functions. Dispatch goes through
+// a jump table once per call, jumps are native branches, and moves and arithmetic call straight
+// into Variant with operand addresses worked out when compiling: state registers and constants,
+// the shot's REG0-7 at fixed offsets from its register array, and its position, speed, direction,
+// rotation and velocity staged through scratch Variants by their accessors. REG0-7 go back to the
+// interpreter while a timer is sleeping on them. States the ahead of time generator would keep in
+// doubles skip Variant altogether: moves, arithmetic and comparisons between them and number
+// constants are SSE2 instructions on the double inside the state's Variant. Every other command
+// calls back into the interpreter one at a time.
+// ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
+
+#ifndef SHOT_EFFECT_JIT_H
+#define SHOT_EFFECT_JIT_H
+
+#if defined(KDANMAKU_JIT) && defined(__x86_64__) && defined(__linux__)
+#define KDANMAKU_JIT_ENABLED
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,119 @@
+// ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
+// *:･ﾟ✧ shot_effect_opcodes.hpp *:･ﾟ✧
+//
+// How ShotEffect commands are encoded, shared by the interpreter and the native code generator.
+// Each command is 32 bits: the opcode in the lowest byte, followed by up to three byte operands.
+// Operands are registers (source in the low 2 bits, index above) or jump targets.
+// ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
+
+#ifndef SHOT_EFFECT_OPCODES_H
+#define SHOT_EFFECT_OPCODES_H
+
+#include "core/typedefs.h"
+
+enum {
+    CMD_MOVE,
+
+    CMD_ADD,
+    CMD_SUB,
+    CMD_MUL,
+    CMD_DIV,
+    CMD_MOD,
+
+    CMD_SIN,
+    CMD_COS,
+    CMD_ATAN2,
+    CMD_LENGTH,
+    CMD_NORMALIZE,
+    CMD_LERP,
+    CMD_AIM,
+
+    CMD_RAND,
+    CMD_RANDR,
+
+    CMD_EQ,
+    CMD_LT,
+    CMD_LE,
+    CMD_TEST,
+
+    CMD_FIRE,
+    CMD_RESET,
+    CMD_SPAWN,
+
+    CMD_TIMER,
+    CMD_YIELD,
+    CMD_END,
+    CMD_CLEAR,
+    CMD_SFX,
+
+    CMD_DEBUG
+};
+
+#define REG_SRC(reg) (reg & 0x03)
+#define REG_IDX(reg) (reg >> 2)
+
+#define CMD(cmd) (cmd & 0xFF)
+#define ARG_A(cmd) ((cmd >> 8) & 0xFF)
+#define ARG_B(cmd) ((cmd >> 16) & 0xFF)
+#define ARG_C(cmd) ((cmd >> 24) & 0xFF)
+
+#define MAKE_CMD_A(cmd, a) ((cmd & 0xFF) | ((a & 0xFF) << 8))
+#define MAKE_CMD_AB(cmd, a, b) ((cmd & 0xFF) | ((a & 0xFF) << 8) | ((b & 0xFF) << 16))
+#define MAKE_CMD_ABC(cmd, a, b, c) ((cmd & 0xFF) | ((a & 0xFF) << 8) | ((b & 0xFF) << 16) | ((c & 0xFF) << 24))
+
+// What the code generators know about a register's type, anything not known until runtime stays a Variant
+enum {
+    KFX_VARIANT,
+    KFX_INT,
+    KFX_REAL,
+    KFX_VECTOR2
+};
+
+// What each operand of a command is, used to check loaded programs and by the code generators
+enum {
+    OPERAND_NONE,
+    OPERAND_READ,
+    OPERAND_WRITE,
+    OPERAND_JUMP,
+    OPERAND_VOLLEY
+};
+
+static const uint8_t command_operands[][3] = {
+    { OPERAND_READ, OPERAND_WRITE, OPERAND_NONE }, // move
+
+    { OPERAND_READ, OPERAND_READ, OPERAND_WRITE }, // add
+    { OPERAND_READ, OPERAND_READ, OPERAND_WRITE }, // sub
+    { OPERAND_READ, OPERAND_READ, OPERAND_WRITE }, // mul
+    { OPERAND_READ, OPERAND_READ, OPERAND_WRITE }, // div
+    { OPERAND_READ, OPERAND_READ, OPERAND_WRITE }, // mod
+
+    { OPERAND_READ, OPERAND_WRITE, OPERAND_NONE }, // sin
+    { OPERAND_READ, OPERAND_WRITE, OPERAND_NONE }, // cos
+    { OPERAND_READ, OPERAND_READ, OPERAND_WRITE }, // atan2
+    { OPERAND_READ, OPERAND_WRITE, OPERAND_NONE }, // length
+    { OPERAND_READ, OPERAND_WRITE, OPERAND_NONE }, // normalize
+    { OPERAND_READ, OPERAND_READ, OPERAND_WRITE }, // lerp
+    { OPERAND_WRITE, OPERAND_NONE, OPERAND_NONE }, // aim
+
+    { OPERAND_WRITE, OPERAND_NONE, OPERAND_NONE }, // rand
+    { OPERAND_READ, OPERAND_READ, OPERAND_WRITE }, // randr
+
+    { OPERAND_READ, OPERAND_READ, OPERAND_JUMP }, // equal
+    { OPERAND_READ, OPERAND_READ, OPERAND_JUMP }, // less
+    { OPERAND_READ, OPERAND_READ, OPERAND_JUMP }, // lesseq
+    { OPERAND_READ, OPERAND_NONE, OPERAND_JUMP }, // test
+
+    { OPERAND_NONE, OPERAND_NONE, OPERAND_NONE }, // fire
+    { OPERAND_NONE, OPERAND_NONE, OPERAND_NONE }, // reset
+    { OPERAND_VOLLEY, OPERAND_NONE, OPERAND_NONE }, // spawn
+
+    { OPERAND_WRITE, OPERAND_NONE, OPERAND_NONE }, // timer
+    { OPERAND_NONE, OPERAND_NONE, OPERAND_NONE }, // yield
+    { OPERAND_NONE, OPERAND_NONE, OPERAND_NONE }, // end
+    { OPERAND_NONE, OPERAND_NONE, OPERAND_NONE }, // clear
+    { OPERAND_READ, OPERAND_NONE, OPERAND_NONE }, // sfx
+
+    { OPERAND_READ, OPERAND_NONE, OPERAND_NONE } // debug
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,149 @@
+// ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
+// *:･ﾟ✧ spatial_grid.hpp *:･ﾟ✧
+//
+// Uniform grid broadphase, rebuilt from scratch whenever it's needed instead of being updated.
+// Items are added as bounding rects, then build() sorts them into cells with a counting sort, so
+// every cell's items end up contiguous in one array and nothing allocates once the arrays have
+// grown to size. Items that lie outside the grid's bounds are kept in the nearest edge cells.
+// ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
+
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include "core/math/rect2.h"
+#include "core/vector.h"
+
+class SpatialGrid {
+    Vector2 origin;
+    float cell_size;
+    int width;
+    int height;
+
+    Vector<Rect2> items;
+    Vector<int> cell_start;
+    Vector<int> cell_items;
+
+    // Items spanning several cells are only reported once per query
+    mutable Vector<uint32_t> stamps;
+    mutable uint32_t stamp;
+
+    _FORCE_INLINE_ void _get_cells(const Rect2& p_rect, int& r_x0, int& r_y0, int& r_x1, int& r_y1) const {
+        r_x0 = CLAMP((int)Math::floor((p_rect.position.x - origin.x) / cell_size), 0, width - 1);
+        r_y0 = CLAMP((int)Math::floor((p_rect.position.y - origin.y) / cell_size), 0, height - 1);
+        r_x1 = CLAMP((int)Math::floor((p_rect.position.x + p_rect.size.x - origin.x) / cell_size), 0, width - 1);
+        r_y1 = CLAMP((int)Math::floor((p_rect.position.y + p_rect.size.y - origin.y) / cell_size), 0, height - 1);
+    }
+
+public:
+    void clear(const Rect2& p_bounds, float p_cell_size) {
+        origin = p_bounds.position;
+        cell_size = MAX(p_cell_size, 1);
+        width = MAX(1, (int)Math::ceil(p_bounds.size.width / cell_size));
+        height = MAX(1, (int)Math::ceil(p_bounds.size.height / cell_size));
+        items.clear();
+        cell_items.clear();
+    }
+
+    _FORCE_INLINE_ int add(const Rect2& p_rect) {
+        items.push_back(p_rect);
+        return items.size() - 1;
+    }
+
+    void build() {
+        cell_start.resize(width * height + 1);
+        int* start = cell_start.ptrw();
+        for (int i = 0; i != cell_start.size(); ++i) {
+            start[i] = 0;
+        }
+
+        // Count the items in each cell, offset by one so the prefix sum gives each cell's start
+        int x0, y0, x1, y1;
+        for (int i = 0; i != items.size(); ++i) {
+            _get_cells(items[i], x0, y0, x1, y1);
+            for (int y = y0; y <= y1; ++y) {
+                for (int x = x0; x <= x1; ++x) {
+                    start[y * width + x + 1]++;
+                }
+            }
+        }
+        for (int i = 1; i != cell_start.size(); ++i) {
+            start[i] += start[i - 1];
+        }
+
+        cell_items.resize(start[width * height]);
+        int* sorted = cell_items.ptrw();
+        for (int i = 0; i != items.size(); ++i) {
+            _get_cells(items[i], x0, y0, x1, y1);
+            for (int y = y0; y <= y1; ++y) {
+                for (int x = x0; x <= x1; ++x) {
+                    sorted[start[y * width + x]++] = i;
+                }
+            }
+        }
+
+        // Filling moved every start up to the next cell's, shift them back
+        for (int i = width * height; i > 0; --i) {
+            start[i] = start[i - 1];
+        }
+        start[0] = 0;
+
+        stamps.resize(items.size());
+        uint32_t* w = stamps.ptrw();
+        for (int i = 0; i != stamps.size(); ++i) {
+            w[i] = 0;
+        }
+        stamp = 0;
+    }
+
+    _FORCE_INLINE_ bool empty() const { return items.empty(); }
+    _FORCE_INLINE_ int get_item_count() const { return items.size(); }
+    _FORCE_INLINE_ const Rect2& get_item_rect(int p_item) const { return items[p_item]; }
+
+    // Calls p_callback(item) for every item whose cells overlap p_rect, which may include items
+    // that don't overlap p_rect themselves. Return false from the callback to stop early.
+    template <typename F>
+    void query(const Rect2& p_rect, F p_callback) const {
+        if (items.empty()) {
+            return;
+        }
+
+        if (++stamp == 0) {
+            uint32_t* w = stamps.ptrw();
+            for (int i = 0; i != stamps.size(); ++i) {
+                w[i] = 0;
+            }
+            stamp = 1;
+        }
+
+        int x0, y0, x1, y1;
+        _get_cells(p_rect, x0, y0, x1, y1);
+        const int* start = cell_start.ptr();
+        const int* sorted = cell_items.ptr();
+        uint32_t* seen = stamps.ptrw();
+
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                int cell = y * width + x;
+                for (int i = start[cell]; i != start[cell + 1]; ++i) {
+                    int item = sorted[i];
+                    if (seen[item] == stamp) {
+                        continue;
+                    }
+                    seen[item] = stamp;
+                    if (!p_callback(item)) {
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+    SpatialGrid() {
+        cell_size = 1;
+        width = 1;
+        height = 1;
+        stamp = 0;
+    }
+};
+
+#endif
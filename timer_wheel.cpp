@@ -0,0 +1,173 @@
+#include "timer_wheel.h"
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+#define LEVEL_INDEX(tick, level) (((tick) >> ((level) * TIMER_WHEEL_BITS)) & SLOT_MASK)
+
+int64_t TimerWheel::schedule(int p_ticks, Object* p_target, const StringName& p_method) {
+    ERR_FAIL_NULL_V(p_target, 0);
+
+    if (free_list == -1) {
+        Timer timer;
+        timer.generation = 1;
+        timer.slot = -1;
+        timer.next = -1;
+        free_list = timers.size();
+        timers.push_back(timer);
+    }
+
+    int index = free_list;
+    Timer& timer = timers.write[index];
+    free_list = timer.next;
+
+    // Like Frames always did, a timer started with zero or fewer ticks fires on the next tick
+    timer.expire = current + MAX(p_ticks, 1);
+    timer.target = p_target->get_instance_id();
+    timer.method = p_method;
+    _insert(index);
+
+    return ((int64_t)timer.generation << 32) | index;
+}
+
+void TimerWheel::cancel(int64_t p_handle) {
+    int index = _resolve(p_handle);
+    if (index == -1) {
+        return;
+    }
+
+    _unlink(index);
+    Timer& timer = timers.write[index];
+    timer.generation++;
+    timer.method = StringName();
+    timer.next = free_list;
+    free_list = index;
+}
+
+int TimerWheel::get_ticks_left(int64_t p_handle) const {
+    int index = _resolve(p_handle);
+    if (index == -1) {
+        return -1;
+    }
+    return timers[index].expire - current;
+}
+
+bool TimerWheel::is_pending(int64_t p_handle) const {
+    return _resolve(p_handle) != -1;
+}
+
+int TimerWheel::get_pending_count() const {
+    int count = 0;
+    for (int i = 0; i != timers.size(); ++i) {
+        if (timers[i].slot != -1) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void TimerWheel::advance() {
+    current++;
+
+    // Whenever a level wraps around, the next slot of the level above is due to be spread out below it
+    for (int level = 1; level != TIMER_WHEEL_LEVELS; ++level) {
+        if (LEVEL_INDEX(current, level - 1) != 0) {
+            break;
+        }
+        _cascade(level);
+    }
+
+    int slot = LEVEL_INDEX(current, 0);
+    while (heads[slot] != -1) {
+        int index = heads[slot];
+        Timer& timer = timers.write[index];
+        ObjectID target = timer.target;
+        StringName method = timer.method;
+
+        // Free the timer before calling back, the callback may well schedule a new one
+        cancel(((int64_t)timer.generation << 32) | index);
+
+        Object* object = ObjectDB::get_instance(target);
+        if (object) {
+            object->call(method);
+        }
+    }
+}
+
+void TimerWheel::clear() {
+    timers.clear();
+    free_list = -1;
+    for (int i = 0; i != TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS; ++i) {
+        heads[i] = -1;
+    }
+}
+
+int TimerWheel::_resolve(int64_t p_handle) const {
+    int index = p_handle & 0xFFFFFFFF;
+    uint32_t generation = p_handle >> 32;
+    if (index < 0 || index >= timers.size()) {
+        return -1;
+    }
+    if (timers[index].generation != generation || timers[index].slot == -1) {
+        return -1;
+    }
+    return index;
+}
+
+void TimerWheel::_insert(int p_timer) {
+    Timer& timer = timers.write[p_timer];
+
+    // Pick the finest level whose slots don't wrap around before the timer expires
+    int level = 0;
+    while (level != TIMER_WHEEL_LEVELS - 1) {
+        int shift = level * TIMER_WHEEL_BITS;
+        if ((timer.expire >> shift) - (current >> shift) < TIMER_WHEEL_SLOTS) {
+            break;
+        }
+        level++;
+    }
+
+    uint64_t expire = timer.expire;
+    int shift = level * TIMER_WHEEL_BITS;
+    if ((expire >> shift) - (current >> shift) >= TIMER_WHEEL_SLOTS) {
+        // Beyond the wheel's range, park in the furthest slot and get re-sorted when it cascades
+        expire = ((current >> shift) + SLOT_MASK) << shift;
+    }
+
+    int slot = level * TIMER_WHEEL_SLOTS + LEVEL_INDEX(expire, level);
+    timer.slot = slot;
+    timer.prev = -1;
+    timer.next = heads[slot];
+    if (heads[slot] != -1) {
+        timers.write[heads[slot]].prev = p_timer;
+    }
+    heads[slot] = p_timer;
+}
+
+void TimerWheel::_unlink(int p_timer) {
+    Timer& timer = timers.write[p_timer];
+    if (timer.prev != -1) {
+        timers.write[timer.prev].next = timer.next;
+    } else {
+        heads[timer.slot] = timer.next;
+    }
+    if (timer.next != -1) {
+        timers.write[timer.next].prev = timer.prev;
+    }
+    timer.slot = -1;
+}
+
+void TimerWheel::_cascade(int p_level) {
+    int slot = p_level * TIMER_WHEEL_SLOTS + LEVEL_INDEX(current, p_level);
+    int index = heads[slot];
+    heads[slot] = -1;
+
+    while (index != -1) {
+        int next = timers[index].next;
+        _insert(index);
+        index = next;
+    }
+}
+
+TimerWheel::TimerWheel() {
+    current = 0;
+    clear();
+}
\ No newline at end of file
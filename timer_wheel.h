@@ -0,0 +1,56 @@
+// ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
+// *:･ﾟ✧ timer_wheel.hpp *:･ﾟ✧
+//
+// Hierarchical timer wheel counting in ticks, owned by Danmaku. Scheduling, cancelling and
+// advancing by one tick are all O(1) no matter how many timers are pending: timers far in the
+// future sit in coarse slots and cascade down to finer levels as their tick gets closer.
+//
+// Timers are referred to by handles, which stay safe to use after the timer fired or was cancelled.
+// ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include "core/object.h"
+#include "core/vector.h"
+
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4
+
+class TimerWheel {
+    struct Timer {
+        uint64_t expire;
+        ObjectID target;
+        StringName method;
+        uint32_t generation;
+        int slot;
+        int prev;
+        int next;
+    };
+
+    Vector<Timer> timers;
+    int free_list;
+    int heads[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS];
+    uint64_t current;
+
+public:
+    int64_t schedule(int p_ticks, Object* p_target, const StringName& p_method);
+    void cancel(int64_t p_handle);
+    int get_ticks_left(int64_t p_handle) const;
+    bool is_pending(int64_t p_handle) const;
+    int get_pending_count() const;
+
+    void advance();
+    void clear();
+
+    TimerWheel();
+
+private:
+    int _resolve(int64_t p_handle) const;
+    void _insert(int p_timer);
+    void _unlink(int p_timer);
+    void _cascade(int p_level);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "tracer.h"
+
+#include "core/os/file_access.h"
+
+void DanmakuTracer::start(int p_capacity) {
+    ERR_FAIL_COND(p_capacity < 1);
+    events.resize(p_capacity);
+    head = 0;
+    count = 0;
+    dropped = 0;
+}
+
+void DanmakuTracer::stop() {
+    events.clear();
+    head = 0;
+    count = 0;
+}
+
+DanmakuTracer::Event* DanmakuTracer::_push() {
+    Event* event = &events.write[head];
+    head = (head + 1) % events.size();
+    if (count < events.size()) {
+        count++;
+    } else {
+        dropped++;
+    }
+    return event;
+}
+
+void DanmakuTracer::span(const StringName& p_name, uint64_t p_begin, uint64_t p_end, int64_t p_shots) {
+    Event* event = _push();
+    event->name = p_name;
+    event->timestamp = p_begin;
+    event->duration = p_end - p_begin;
+    event->value = p_shots;
+    event->type = TYPE_SPAN;
+}
+
+void DanmakuTracer::counter(const StringName& p_name, uint64_t p_timestamp, int64_t p_value) {
+    Event* event = _push();
+    event->name = p_name;
+    event->timestamp = p_timestamp;
+    event->duration = 0;
+    event->value = p_value;
+    event->type = TYPE_COUNTER;
+}
+
+Error DanmakuTracer::flush(const String& p_path) {
+    Error err;
+    FileAccess* file = FileAccess::open(p_path, FileAccess::WRITE, &err);
+    ERR_FAIL_COND_V_MSG(err != OK, err, "Cannot open trace file '" + p_path + "'.");
+
+    file->store_string("{\"traceEvents\":[\n");
+
+    int first = (head - count + events.size()) % MAX(events.size(), 1);
+    for (int i = 0; i != count; ++i) {
+        const Event& event = events[(first + i) % events.size()];
+        String name = String(event.name).json_escape();
+
+        String line;
+        if (event.type == TYPE_SPAN) {
+            line = "{\"name\":\"" + name + "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" + itos(event.timestamp) + ",\"dur\":" + itos(event.duration);
+            if (event.value >= 0) {
+                line += ",\"args\":{\"shots\":" + itos(event.value) + "}";
+            }
+            line += "}";
+        } else {
+            line = "{\"name\":\"" + name + "\",\"ph\":\"C\",\"pid\":1,\"ts\":" + itos(event.timestamp) + ",\"args\":{\"" + name + "\":" + itos(event.value) + "}}";
+        }
+        file->store_string(i + 1 == count ? line + "\n" : line + ",\n");
+    }
+
+    file->store_string("],\"otherData\":{\"dropped_events\":" + itos(dropped) + "}}\n");
+    file->close();
+    memdelete(file);
+
+    // Flushed events are gone; the buffer keeps recording from empty
+    head = 0;
+    count = 0;
+    dropped = 0;
+    return OK;
+}
+
+DanmakuTracer::DanmakuTracer() {
+    head = 0;
+    count = 0;
+    dropped = 0;
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+// ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
+// *:･ﾟ✧ tracer.hpp *:･ﾟ✧
+//
+// Records Danmaku tick phases as Chrome trace events (viewable in chrome://tracing or Perfetto).
+// Events go into a ring buffer that is allocated once when tracing starts, so recording never
+// allocates; when the buffer is full the oldest events are overwritten. Nothing is formatted
+// until the buffer is flushed to disk.
+// ======== ======== ======== ======== ======== ======== ======== ======== ======== ======== ========
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include "core/error_list.h"
+#include "core/string_name.h"
+#include "core/ustring.h"
+#include "core/vector.h"
+
+class DanmakuTracer {
+    enum Type {
+        TYPE_SPAN,
+        TYPE_COUNTER
+    };
+
+    struct Event {
+        StringName name;
+        uint64_t timestamp;
+        uint64_t duration;
+        int64_t value;
+        Type type;
+    };
+
+    Vector<Event> events;
+    int head;
+    int count;
+    uint64_t dropped;
+
+public:
+    void start(int p_capacity);
+    void stop();
+    _FORCE_INLINE_ bool is_active() const { return events.size() != 0; }
+
+    void span(const StringName& p_name, uint64_t p_begin, uint64_t p_end, int64_t p_shots = -1);
+    void counter(const StringName& p_name, uint64_t p_timestamp, int64_t p_value);
+
+    Error flush(const String& p_path);
+
+    DanmakuTracer();
+
+private:
+    Event* _push();
+};
+
+#endif
\ No newline at end of file